@@ -0,0 +1,210 @@
+/*
+ *  fspc action set implementation
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "action_bitset.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+
+/* ========================= ActionBitset =========================== */
+const unsigned int fsp::ActionBitset::None;
+
+fsp::ActionBitset::ActionBitset(const set<unsigned int>& actions)
+                                                        : cardinality(0)
+{
+    if (!actions.empty()) {
+        words.resize((*actions.rbegin() >> 6) + 1, 0);
+    }
+    for (set<unsigned int>::const_iterator it = actions.begin();
+                                        it != actions.end(); it++) {
+        words[*it >> 6] |= uint64_t(1) << (*it & 63);
+    }
+    cardinality = actions.size();
+}
+
+/* Return the smallest action in the set that is not less than 'from',
+   or None. */
+unsigned int fsp::ActionBitset::next(unsigned int from) const
+{
+    unsigned int w = from >> 6;
+    uint64_t bits;
+
+    if (from == None || w >= words.size()) {
+        return None;
+    }
+
+    bits = words[w] & (~uint64_t(0) << (from & 63));
+    while (!bits) {
+        if (++w == words.size()) {
+            return None;
+        }
+        bits = words[w];
+    }
+
+    return (w << 6) + __builtin_ctzll(bits);
+}
+
+/* Drop the trailing zero words, so that equal sets have the same
+   representation. */
+void fsp::ActionBitset::trim()
+{
+    while (!words.empty() && !words.back()) {
+        words.pop_back();
+    }
+}
+
+bool fsp::ActionBitset::insert(unsigned int action)
+{
+    unsigned int w = action >> 6;
+    uint64_t bit = uint64_t(1) << (action & 63);
+
+    if (w >= words.size()) {
+        words.resize(w + 1, 0);
+    }
+    if (words[w] & bit) {
+        return false;
+    }
+    words[w] |= bit;
+    cardinality++;
+
+    return true;
+}
+
+size_t fsp::ActionBitset::erase(unsigned int action)
+{
+    if (!count(action)) {
+        return 0;
+    }
+    words[action >> 6] &= ~(uint64_t(1) << (action & 63));
+    cardinality--;
+    trim();
+
+    return 1;
+}
+
+void fsp::ActionBitset::clear()
+{
+    words.clear();
+    cardinality = 0;
+}
+
+void fsp::ActionBitset::swap(ActionBitset& other)
+{
+    words.swap(other.words);
+    std::swap(cardinality, other.cardinality);
+}
+
+unsigned int fsp::ActionBitset::bound() const
+{
+    if (words.empty()) {
+        return 0;
+    }
+
+    return ((words.size() - 1) << 6) + 64 - __builtin_clzll(words.back());
+}
+
+bool fsp::ActionBitset::intersects(const ActionBitset& other) const
+{
+    unsigned int n = min(words.size(), other.words.size());
+
+    for (unsigned int w = 0; w < n; w++) {
+        if (words[w] & other.words[w]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Return true if 'other' is a subset of *this. */
+bool fsp::ActionBitset::includes(const ActionBitset& other) const
+{
+    if (other.words.size() > words.size()) {
+        return false;
+    }
+
+    for (unsigned int w = 0; w < other.words.size(); w++) {
+        if (other.words[w] & ~words[w]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+fsp::ActionBitset& fsp::ActionBitset::unite(const ActionBitset& other)
+{
+    if (words.size() < other.words.size()) {
+        words.resize(other.words.size(), 0);
+    }
+
+    cardinality = 0;
+    for (unsigned int w = 0; w < words.size(); w++) {
+        if (w < other.words.size()) {
+            words[w] |= other.words[w];
+        }
+        cardinality += __builtin_popcountll(words[w]);
+    }
+
+    return *this;
+}
+
+fsp::ActionBitset& fsp::ActionBitset::intersect(const ActionBitset& other)
+{
+    if (words.size() > other.words.size()) {
+        words.resize(other.words.size());
+    }
+
+    cardinality = 0;
+    for (unsigned int w = 0; w < words.size(); w++) {
+        words[w] &= other.words[w];
+        cardinality += __builtin_popcountll(words[w]);
+    }
+    trim();
+
+    return *this;
+}
+
+fsp::ActionBitset& fsp::ActionBitset::subtract(const ActionBitset& other)
+{
+    unsigned int n = min(words.size(), other.words.size());
+
+    cardinality = 0;
+    for (unsigned int w = 0; w < words.size(); w++) {
+        if (w < n) {
+            words[w] &= ~other.words[w];
+        }
+        cardinality += __builtin_popcountll(words[w]);
+    }
+    trim();
+
+    return *this;
+}
+
+bool fsp::ActionBitset::operator==(const ActionBitset& other) const
+{
+    return cardinality == other.cardinality && words == other.words;
+}
+
+set<unsigned int> fsp::ActionBitset::toSet() const
+{
+    return set<unsigned int>(begin(), end());
+}
@@ -0,0 +1,126 @@
+/*
+ *  fspc action set implementation
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __ACTION__BITSET__HH
+#define __ACTION__BITSET__HH
+
+#include <vector>
+#include <set>
+#include <iterator>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+
+namespace fsp {
+
+/* A set of actions (indexes in the ActionsTable), stored as a dense
+   bitmap. Since the actions table is shared by all the processes, the
+   alphabets are small subsets of a small index space, so that a bitmap
+   is both more compact than a set<unsigned int> and much faster:
+   membership is a single bit test, while union, intersection and
+   difference work a word (64 actions) at a time.
+
+   The interface is a subset of the one of set<unsigned int> (the
+   elements are visited in increasing order), so that the two can be
+   used in the same way. */
+class ActionBitset {
+    vector<uint64_t> words;
+    unsigned int cardinality;
+
+    static const unsigned int None = ~0U;
+
+    unsigned int next(unsigned int from) const;
+    void trim();
+
+  public:
+    class const_iterator {
+        const ActionBitset *owner;
+        unsigned int pos;
+
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef unsigned int value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const unsigned int *pointer;
+        typedef const unsigned int& reference;
+
+        const_iterator(const ActionBitset *o, unsigned int p)
+                                                : owner(o), pos(p) { }
+        const unsigned int& operator*() const { return pos; }
+        const_iterator& operator++() {
+            pos = owner->next(pos + 1);
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator ret = *this;
+
+            ++(*this);
+            return ret;
+        }
+        bool operator==(const const_iterator& it) const {
+            return pos == it.pos;
+        }
+        bool operator!=(const const_iterator& it) const {
+            return pos != it.pos;
+        }
+    };
+    typedef const_iterator iterator;
+
+    ActionBitset() : cardinality(0) { }
+    explicit ActionBitset(const set<unsigned int>& actions);
+
+    size_t count(unsigned int action) const {
+        return (action >> 6) < words.size() &&
+                        ((words[action >> 6] >> (action & 63)) & 1);
+    }
+    bool insert(unsigned int action);
+    size_t erase(unsigned int action);
+    unsigned int size() const { return cardinality; }
+    bool empty() const { return cardinality == 0; }
+    void clear();
+    void swap(ActionBitset& other);
+
+    const_iterator begin() const { return const_iterator(this, next(0)); }
+    const_iterator end() const { return const_iterator(this, None); }
+
+    /* One more than the largest action in the set (0 if the set is
+       empty). */
+    unsigned int bound() const;
+
+    /* Word-parallel set algebra. */
+    bool intersects(const ActionBitset& other) const;
+    bool includes(const ActionBitset& other) const;
+    ActionBitset& unite(const ActionBitset& other);
+    ActionBitset& intersect(const ActionBitset& other);
+    ActionBitset& subtract(const ActionBitset& other);
+
+    bool operator==(const ActionBitset& other) const;
+    bool operator!=(const ActionBitset& other) const {
+        return !(*this == other);
+    }
+
+    set<unsigned int> toSet() const;
+};
+
+}
+
+#endif
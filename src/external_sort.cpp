@@ -0,0 +1,291 @@
+/*
+ *  fspc external memory support
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "external_sort.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <unistd.h>
+
+using namespace std;
+
+
+/* ========================== RecordFile ============================ */
+fsp::RecordFile::RecordFile(const string& dir, unsigned int w)
+                            : width(w), count(0)
+{
+    string path = dir + "/fspc-XXXXXX";
+    vector<char> templ(path.begin(), path.end());
+    int fd;
+
+    templ.push_back('\0');
+    fd = mkstemp(&templ[0]);
+    if (fd < 0 || !(fp = fdopen(fd, "w+b"))) {
+        cerr << "RecordFile: cannot create a temporary file in "
+                << dir << "\n";
+        exit(EXIT_FAILURE);
+    }
+    /* The file is removed when closed. */
+    unlink(&templ[0]);
+}
+
+fsp::RecordFile::~RecordFile()
+{
+    fclose(fp);
+}
+
+void fsp::RecordFile::write(const uint32_t *rec)
+{
+    if (fwrite(rec, sizeof(uint32_t), width, fp) != width) {
+        cerr << "RecordFile: write error\n";
+        exit(EXIT_FAILURE);
+    }
+    count++;
+}
+
+/* Prepare the file to be read from the beginning. */
+void fsp::RecordFile::rewind()
+{
+    fflush(fp);
+    fseek(fp, 0, SEEK_SET);
+}
+
+/* Read the next record, returning false at the end of the file. */
+bool fsp::RecordFile::read(uint32_t *rec)
+{
+    return fread(rec, sizeof(uint32_t), width, fp) == width;
+}
+
+
+/* ========================= RecordSorter =========================== */
+fsp::RecordSorter::RecordSorter(const string& d, unsigned int w,
+                                size_t memory)
+                                : dir(d), width(w), pos(0)
+{
+    assert(width);
+    max_records = max(memory / (width * sizeof(uint32_t)), size_t(1024));
+}
+
+fsp::RecordSorter::~RecordSorter()
+{
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        delete runs[i];
+    }
+}
+
+/* Compare two records of the 'buffer' array, identified by their
+   offsets. */
+struct RecordLess {
+    const uint32_t *base;
+    unsigned int width;
+
+    RecordLess(const uint32_t *b, unsigned int w) : base(b), width(w) { }
+    bool operator()(size_t a, size_t b) const {
+        return lexicographical_compare(base + a, base + a + width,
+                                       base + b, base + b + width);
+    }
+};
+
+/* Sort the buffer. If 'run' is not NULL, the sorted records are
+   written to it and the buffer is emptied. */
+static void sort_buffer(vector<uint32_t>& buffer, unsigned int width,
+                        fsp::RecordFile *run)
+{
+    vector<size_t> order;
+    vector<uint32_t> sorted;
+
+    if (buffer.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < buffer.size(); i += width) {
+        order.push_back(i);
+    }
+    sort(order.begin(), order.end(), RecordLess(buffer.data(), width));
+
+    if (run) {
+        for (size_t i = 0; i < order.size(); i++) {
+            run->write(&buffer[order[i]]);
+        }
+        buffer.clear();
+        return;
+    }
+
+    sorted.reserve(buffer.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted.insert(sorted.end(), buffer.begin() + order[i],
+                      buffer.begin() + order[i] + width);
+    }
+    buffer.swap(sorted);
+}
+
+/* Write the buffer to a new sorted run. */
+void fsp::RecordSorter::spill()
+{
+    RecordFile *run = new RecordFile(dir, width);
+
+    sort_buffer(buffer, width, run);
+    run->rewind();
+    runs.push_back(run);
+    levels.push_back(0);
+
+    /* The levels are non increasing along 'runs', so the last MaxFanIn
+       runs have the same level if the first of them has the level of
+       the last one. */
+    while (runs.size() >= MaxFanIn &&
+            levels[runs.size() - MaxFanIn] == levels.back()) {
+        collapse();
+    }
+}
+
+void fsp::RecordSorter::add(const uint32_t *rec)
+{
+    buffer.insert(buffer.end(), rec, rec + width);
+    if (buffer.size() >= max_records * width) {
+        spill();
+    }
+}
+
+bool fsp::RecordSorter::less(unsigned int a, unsigned int b) const
+{
+    const uint32_t *ha = &heads[a * width];
+    const uint32_t *hb = &heads[b * width];
+
+    return lexicographical_compare(ha, ha + width, hb, hb + width);
+}
+
+/* Restore the heap property, moving down the element at position 'i'. */
+void fsp::RecordSorter::sift(size_t i)
+{
+    for (;;) {
+        size_t smallest = i;
+        size_t l = 2 * i + 1;
+        size_t r = 2 * i + 2;
+
+        if (l < heap.size() && less(heap[l], heap[smallest])) {
+            smallest = l;
+        }
+        if (r < heap.size() && less(heap[r], heap[smallest])) {
+            smallest = r;
+        }
+        if (smallest == i) {
+            break;
+        }
+        swap(heap[i], heap[smallest]);
+        i = smallest;
+    }
+}
+
+/* Prepare to merge the runs from position 'first' to the end of
+   'runs', reading their first records. */
+void fsp::RecordSorter::startMerge(size_t first)
+{
+    heads.resize(runs.size() * width);
+    heap.clear();
+    for (size_t i = first; i < runs.size(); i++) {
+        if (runs[i]->read(&heads[i * width])) {
+            heap.push_back(i);
+        }
+    }
+    for (size_t i = heap.size() / 2; i > 0; i--) {
+        sift(i - 1);
+    }
+}
+
+/* Return the smallest record among the runs being merged, or false if
+   they are all exhausted. */
+bool fsp::RecordSorter::mergeNext(uint32_t *rec)
+{
+    unsigned int r;
+
+    if (heap.empty()) {
+        return false;
+    }
+    r = heap[0];
+    memcpy(rec, &heads[r * width], width * sizeof(uint32_t));
+    if (!runs[r]->read(&heads[r * width])) {
+        heap[0] = heap.back();
+        heap.pop_back();
+    }
+    sift(0);
+
+    return true;
+}
+
+/* Merge the last MaxFanIn runs into a single run, whose level is one
+   more than the level of the first of them. */
+void fsp::RecordSorter::collapse()
+{
+    size_t first = runs.size() - MaxFanIn;
+    unsigned int level = levels[first] + 1;
+    RecordFile *merged = new RecordFile(dir, width);
+    vector<uint32_t> rec(width);
+
+    startMerge(first);
+    while (mergeNext(rec.data())) {
+        merged->write(rec.data());
+    }
+    for (size_t i = first; i < runs.size(); i++) {
+        delete runs[i];
+    }
+    runs.resize(first);
+    levels.resize(first);
+    merged->rewind();
+    runs.push_back(merged);
+    levels.push_back(level);
+}
+
+/* No more records will be added: prepare the sorted output. If all the
+   records fit in the buffer, they are sorted in memory. Otherwise the
+   smallest runs are merged until at most MaxFanIn of them are left,
+   and these are merged while the records are returned. */
+void fsp::RecordSorter::finish()
+{
+    pos = 0;
+    if (runs.empty()) {
+        sort_buffer(buffer, width, NULL);
+        return;
+    }
+
+    if (buffer.size()) {
+        spill();
+    }
+    while (runs.size() > MaxFanIn) {
+        collapse();
+    }
+    startMerge(0);
+}
+
+/* Return the next record in sorted order, or false if there are no
+   more records. */
+bool fsp::RecordSorter::next(uint32_t *rec)
+{
+    if (runs.empty()) {
+        if (pos >= buffer.size()) {
+            return false;
+        }
+        memcpy(rec, &buffer[pos], width * sizeof(uint32_t));
+        pos += width;
+        return true;
+    }
+
+    return mergeNext(rec);
+}
@@ -0,0 +1,95 @@
+/*
+ *  fspc external memory support
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __EXTERNAL__SORT__HH
+#define __EXTERNAL__SORT__HH
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+using namespace std;
+
+
+namespace fsp {
+
+/* A temporary file containing fixed size records, each one being an
+   array of 'width' 32 bit words. The file is created in the directory
+   'dir' and it is removed as soon as it is opened, so that it
+   disappears when the object is destroyed (or the program exits).
+   The records are written sequentially, then the file is rewound and
+   read back sequentially. */
+class RecordFile {
+    FILE *fp;
+    unsigned int width;
+    uint64_t count;
+
+  public:
+    RecordFile(const string& dir, unsigned int w);
+    ~RecordFile();
+    void write(const uint32_t *rec);
+    void rewind();
+    bool read(uint32_t *rec);
+    uint64_t size() const { return count; }
+};
+
+/* External merge sort of fixed size records, in lexicographic order.
+   The records are collected in a memory buffer of at most 'memory'
+   bytes. When the buffer is full, it is sorted and written to a
+   temporary file (a run). After finish() is called, next() returns
+   the records in sorted order, merging all the runs. Each run keeps
+   a file open, so at most 'MaxFanIn' runs are merged at a time: when
+   that many runs of the same level exist, they are merged into a
+   single run of the next level. */
+class RecordSorter {
+    static const unsigned int MaxFanIn = 16;
+
+    string dir;
+    unsigned int width;
+    size_t max_records;
+    vector<uint32_t> buffer;
+    vector<RecordFile *> runs;
+    vector<unsigned int> levels;
+
+    /* Merge state: the current record of each run, and a binary heap
+       of the runs that are not exhausted, ordered by current record. */
+    vector<uint32_t> heads;
+    vector<unsigned int> heap;
+    size_t pos;
+
+    bool less(unsigned int a, unsigned int b) const;
+    void sift(size_t i);
+    void startMerge(size_t first);
+    bool mergeNext(uint32_t *rec);
+    void collapse();
+    void spill();
+
+  public:
+    RecordSorter(const string& d, unsigned int w, size_t memory);
+    ~RecordSorter();
+    void add(const uint32_t *rec);
+    void finish();
+    bool next(uint32_t *rec);
+};
+
+}  /* namespace fsp */
+
+#endif
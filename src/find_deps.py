@@ -120,7 +120,7 @@ def find_include_deps(g):
 
 # Build the graph from the sources and save it into "deps.gv"
 extensions = ['cpp', 'hpp', 'hh']
-blacklist = ['test-serializer.cpp']
+blacklist = ['test-serializer.cpp', 'test-lts.cpp']
 
 files = get_files(extensions, blacklist)
 
@@ -45,6 +45,7 @@ void fsp_scan_end();
 FspDriver::FspDriver()
 {
     trace_scanning = trace_parsing = false;
+    lazy_request = false;
     tree = NULL;
 }
 
@@ -343,6 +344,22 @@ int FspDriver::inputPhase(stringstream& ss)
         /* Collect and translate the process definitions. */
         translateProcessesDefinitions();
 
+        if (cop.compositional) {
+            ss << "Compositional minimization: " << stats.minimized
+                << " LTSs minimized, " << stats.states_before
+                << " --> " << stats.states_after << " states\n";
+            for (unsigned int i = 0; i < stats.plans.size(); i++) {
+                ss << "    Composition plan for " << stats.plans[i] << "\n";
+            }
+        }
+        if (cop.symmetry) {
+            ss << "Symmetry reduction: " << stats.symmetries.size()
+                << " composite processes reduced\n";
+            for (unsigned int i = 0; i < stats.symmetries.size(); i++) {
+                ss << "    " << stats.symmetries[i] << "\n";
+            }
+        }
+
         DBRT(fsp::PtrCheckTable::get()->check());
     } else { /* Load the processes table from an LTS file. */
 	uint32_t nlts, nprogr;
@@ -388,8 +405,9 @@ int FspDriver::outputPhase(stringstream& ss)
     fsp::ActionsTable& actions = fsp::ActionsTable::getref();
     Serializer *serp = NULL;
     map<string, fsp::Symbol *>::iterator it;
-    map<string, fsp::Symbol *>::iterator jt;
-    fsp::SmartPtr<fsp::Lts> lts;
+    vector<fsp::Lts *> ltsv;
+    vector<fsp::ProgressCheck> checks;
+    vector<fsp::AnalysisReport> reports;
     fsp::ProgressS *pv;
 
     if (cop.input_type == CompilerOptions::InputTypeFsp && cop.output_file) {
@@ -402,38 +420,45 @@ int FspDriver::outputPhase(stringstream& ss)
     }
 
     /* Scan the 'processes' symbols table. For each process, output
-       the associated LTS and do the deadlock analysis. */
+       the associated LTS. */
     for (it=processes.table.begin(); it!=processes.table.end(); it++) {
-	lts = fsp::is<fsp::Lts>(it->second);
+	ltsv.push_back(fsp::is<fsp::Lts>(it->second));
 
 	/* We output an LTS file only if the input is not an LTS file. */
 	if (serp) {
-	    serp->lts(*lts, 0);
+	    serp->lts(*ltsv.back()->unreduced(), 0);
 	}
+    }
 
-	if (cop.deadlock) {
-	    lts->deadlockAnalysis(ss);
-	}
+    if (cop.progress) {
+        for (it=progresses.table.begin(); it!=progresses.table.end();
+                it++) {
+            pv = fsp::is<fsp::ProgressS>(it->second);
+            checks.push_back(fsp::ProgressCheck(it->first, pv));
+        }
+    }
 
-	if (cop.graphviz) {
-	    lts->graphvizOutput((lts->name + ".gv").c_str(), true);
-	}
+    /* Analyze the processes, possibly in parallel. The reports are
+       output in the same order as a serial analysis would do: first
+       the deadlock analysis of each process, and then each progress
+       check against all the global processes. */
+    fsp::analyze_processes(ltsv, cop.deadlock, cop.graphviz, checks,
+                           cop.jobs, reports);
+    for (unsigned int i=0; i<reports.size(); i++) {
+        ss << reports[i].deadlock;
+    }
+    for (unsigned int k=0; k<checks.size(); k++) {
+        for (unsigned int i=0; i<reports.size(); i++) {
+            ss << reports[i].progress[k];
+        }
     }
 
     if (serp) {
 	serp->integer(progresses.table.size(), 0);
     }
-    /* Do each progress check against all the global processes. */
     for (it=progresses.table.begin(); it!=progresses.table.end();
 	    it++) {
 	pv = fsp::is<fsp::ProgressS>(it->second);
-	if (cop.progress) {
-	    for (jt=processes.table.begin();
-		    jt!=processes.table.end(); jt++) {
-		lts = fsp::is<fsp::Lts>(jt->second);
-		lts->progress(it->first, *pv, ss);
-	    }
-	}
 
 	/* Output the property if the input is not an LTS file. */
 	if (serp) {
@@ -455,6 +480,11 @@ int FspDriver::parse(const CompilerOptions& co)
 
     /* Copy in the options. */
     cop = co;
+    fsp::Lts::compose_jobs = cop.jobs;
+    fsp::Lts::setComposeAlgorithm(cop.compose_algorithm);
+    if (cop.external_dir) {
+        fsp::Lts::external_dir = cop.external_dir;
+    }
 
     ret = inputPhase(ss);
     if (ret) {
@@ -692,6 +722,61 @@ fsp::SmartPtr<fsp::Lts> FspDriver::getLts(const string& name, bool create)
     return lts;
 }
 
+/* Ask the compiler for a lazy view of the composite process specified
+   by 'name' (see LazyLts): only its components are translated, and the
+   composite states are computed while the view is explored.
+   Returns NULL if 'name' is not a composite process, or if its LTS
+   has already been computed (or cannot be computed lazily): in these
+   cases the caller should use getLts(). The returned view is not
+   stored in the 'processes' table.
+   Since the view explores the plain product of the components, it is
+   not used when a reduction of the composite processes has been
+   requested. */
+fsp::SmartPtr<fsp::LazyLts> FspDriver::getLazyLts(const string& name)
+{
+    fsp::Symbol *svp;
+    fsp::ParametricProcess *pp;
+    fsp::SmartPtr<fsp::Lts> lts;
+    fsp::SmartPtr<fsp::LazyLts> result;
+    fsp::LtsTreeNode *ltn;
+    string base;
+    string extension;
+    vector<int> args;
+
+    if (cop.compositional || cop.partial_order || cop.symmetry) {
+        return NULL;
+    }
+
+    if (!parse_extended_name(name, base, args) ||
+            !parametric_processes.lookup(base, svp)) {
+        return NULL;
+    }
+    pp = fsp::is<fsp::ParametricProcess>(svp);
+    if (!isCompositeDefinition(pp) ||
+            (args.size() && args.size() != pp->defaults.size())) {
+        return NULL;
+    }
+    if (!args.size()) {
+        args = pp->defaults;
+    }
+
+    lts_name_extension(args, extension);
+    if (processes.lookup(base + extension, svp)) {
+        return NULL;
+    }
+
+    ltn = dynamic_cast<fsp::LtsTreeNode *>(pp->translator);
+    assert(ltn);
+    lazy_request = true;
+    process_ref_translate(*this, ltn->getLocation(), base, &args, &lts,
+                          false);
+    lazy_request = false;
+    result = lazy;
+    lazy.clear();
+
+    return result;
+}
+
 void FspDriver::error(const fsp::location& l, const std::string& m)
 {
     print_error_location_pretty(l);
@@ -769,6 +854,22 @@ void DependencyGraph::findDependencies(const string& depends,
     }
 }
 
+/* Return true if some process depends on the process 'name'. */
+bool DependencyGraph::isReferenced(const string& name) const
+{
+    map< string, vector<string> >::const_iterator mit;
+
+    for (mit = table.begin(); mit != table.end(); mit++) {
+        for (unsigned int i = 0; i < mit->second.size(); i++) {
+            if (mit->second[i] == name && mit->first != name) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 void DependencyGraph::print()
 {
     for (table_iterator mit = table.begin(); mit != table.end(); mit++) {
@@ -42,9 +42,27 @@ class DependencyGraph {
     public:
         bool add(const string& depends, const string& on);
         void findDependencies(const string& depends, vector<string>& result);
+        bool isReferenced(const string& name) const;
         void print();
 };
 
+/* Statistics collected during the compilation. */
+struct CompileStats {
+    /* Compositional minimization: number of minimized LTSs, and
+       total number of states before and after minimization. */
+    unsigned int minimized;
+    uint64_t states_before;
+    uint64_t states_after;
+
+    /* The composition plans chosen by the composition planner. */
+    vector<string> plans;
+
+    /* The composite processes computed with symmetry reduction. */
+    vector<string> symmetries;
+
+    CompileStats() : minimized(0), states_before(0), states_after(0) { }
+};
+
 /* Conducting the whole scanning and parsing of fspcc. */
 class FspDriver
 {
@@ -98,6 +116,15 @@ class FspDriver
         /* Preprocessed file, input to the parser. */
 	string remove_file;
 
+        /* Compilation statistics. */
+        CompileStats stats;
+
+        /* Lazy composition support (see getLazyLts()): if 'lazy_request'
+           is set, the composite process definition being translated is
+           not composed, but stored into 'lazy'. */
+        bool lazy_request;
+        fsp::SmartPtr<fsp::LazyLts> lazy;
+
 
 	FspDriver();
 	virtual ~FspDriver();
@@ -122,6 +149,7 @@ class FspDriver
         void translateProcessesDefinitions();
 
         fsp::SmartPtr<fsp::Lts> getLts(const string& name, bool create);
+        fsp::SmartPtr<fsp::LazyLts> getLazyLts(const string& name);
 
 	/* Error handling. */
 	void error(const fsp::location& l, const std::string& m);
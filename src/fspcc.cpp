@@ -33,7 +33,7 @@ using namespace std;
 void help()
 {
     cout << "fspc - A Finite State Process compiler and LTS analisys tool.\n";
-    cout << "USAGE: fspc [-dpgasSh] [-i FILE | -l FILE] [-o FILE]\n";
+    cout << "USAGE: fspc [-dpgamrysSh] [-j NUM] [-c NUM] [-x DIR] [-A ALGO] [-i FILE | -l FILE] [-o FILE]\n";
     cout << "   -i FILE : Specifies FILE as the input file containing "
         "FSP definitions.\n";
     cout << "   -l FILE : Specifies FILE as the input file containing "
@@ -45,10 +45,29 @@ void help()
         "every FSP.\n";
     cout << "   -g : Outputs a graphviz representation file of every FSP.\n";
     cout << "   -a : The same as '-d -p -g'\n";
+    cout << "   -m : Minimizes the components of composite processes "
+        "before composing them (compositional minimization).\n";
+    cout << "   -r : Uses partial order reduction to compute the composite "
+        "processes that are not referenced by other processes. The "
+        "resulting LTSs only preserve deadlocks and property violations, "
+        "and are only used for the deadlock analysis.\n";
+    cout << "   -y : Uses symmetry reduction to compute the composite "
+        "processes that are not referenced by other processes and that "
+        "contain replicated components. The resulting LTSs contain one "
+        "state for each orbit of symmetric states.\n";
     cout << "   -s : Runs an LTS analysis interactive shell\n";
     cout << "   -S FILE : Runs an LTS analysis script\n";
     cout << "   -D NUM : The maximum depth of process references accepted "
         "within a process definition (default is 1000)\n";
+    cout << "   -j NUM : The number of threads used to compute parallel "
+        "compositions and to analyze the processes (default is 1)\n";
+    cout << "   -c NUM : Checks composite processes for deadlocks and "
+        "property violations while composing them, and aborts the "
+        "compilation after NUM violations\n";
+    cout << "   -x DIR : Computes parallel compositions in external memory, "
+        "using temporary files in the directory DIR\n";
+    cout << "   -A ALGO : The parallel composition algorithm: 'declarative', "
+        "'operational' or 'auto' (default is 'auto')\n";
     cout << "   -v : Shows versioning information\n";
     cout << "   -h : Shows this help.\n";
 }
@@ -76,8 +95,15 @@ void process_args(CompilerOptions& co, int argc, char **argv)
     co.shell = false;
     co.script = false;
     co.max_reference_depth = 1000;
-
-    while ((ch = getopt(argc, argv, "i:l:o:adpghsvS:D:")) != -1) {
+    co.jobs = 1;
+    co.compositional = false;
+    co.partial_order = false;
+    co.symmetry = false;
+    co.max_violations = 0;
+    co.external_dir = NULL;
+    co.compose_algorithm = "auto";
+
+    while ((ch = getopt(argc, argv, "i:l:o:adpghmrysvS:D:j:c:x:A:")) != -1) {
         switch (ch) {
             default:
                 cout << "\n";
@@ -117,6 +143,18 @@ void process_args(CompilerOptions& co, int argc, char **argv)
                 co.graphviz = true;
                 break;
 
+            case 'm':
+                co.compositional = true;
+                break;
+
+            case 'r':
+                co.partial_order = true;
+                break;
+
+            case 'y':
+                co.symmetry = true;
+                break;
+
             case 'h':
                 help();
                 exit(0);
@@ -135,6 +173,37 @@ void process_args(CompilerOptions& co, int argc, char **argv)
                 co.max_reference_depth = atoi(optarg);
                 break;
 
+            case 'j':
+                if (atoi(optarg) < 1) {
+                    cerr << "Error: Invalid number of threads\n\n";
+                    help();
+                    exit(-1);
+                }
+                co.jobs = atoi(optarg);
+                break;
+
+            case 'c':
+                if (atoi(optarg) < 1) {
+                    cerr << "Error: Invalid number of violations\n\n";
+                    help();
+                    exit(-1);
+                }
+                co.max_violations = atoi(optarg);
+                break;
+
+            case 'x':
+                co.external_dir = optarg;
+                break;
+
+            case 'A':
+                if (!fsp::Lts::setComposeAlgorithm(optarg)) {
+                    cerr << "Error: Invalid composition algorithm\n\n";
+                    help();
+                    exit(-1);
+                }
+                co.compose_algorithm = optarg;
+                break;
+
             case 'v':
                 cout << "fspc 1.8 (August 2014)\n";
                 cout << "Copyright 2013-2014 Vincenzo Maffione\n";
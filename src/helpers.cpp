@@ -61,22 +61,10 @@ void lts_name_extension(const vector<int>& values, string& extension)
     }
 }
 
-bool intersection_exists(const set<unsigned int>& first,
-                         const set<unsigned int>& second)
+bool intersection_exists(const fsp::ActionBitset& first,
+                         const fsp::ActionBitset& second)
 {
-    const set<unsigned int>& bigger = (first.size() > second.size())
-                                        ? first : second;
-    const set<unsigned int>& smaller = (first.size() > second.size())
-                                        ? second : first;
-
-    for (set<unsigned int>:: iterator it = smaller.begin();
-                            it != smaller.end(); it++) {
-        if (bigger.count(*it)) {
-            return true;
-        }
-    }
-
-    return false;
+    return first.intersects(second);
 }
 
 void merge_string_vec(const vector<string>& vec, string& res,
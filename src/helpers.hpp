@@ -18,6 +18,8 @@
  */
 
 
+#include "action_bitset.hpp"
+
 #include <string>
 #include <vector>
 #include <set>
@@ -28,8 +30,8 @@ using namespace std;
 string int2string(int x);
 int string2int(const string& s, int& ret);
 void lts_name_extension(const vector<int>& values, string& extension);
-bool intersection_exists(const set<unsigned int>&,
-                         const set<unsigned int>&);
+bool intersection_exists(const fsp::ActionBitset&,
+                         const fsp::ActionBitset&);
 void merge_string_vec(const vector<string>& vec, string& res,
                         const string& separator);
 string get_tmp_name(const string& prefix, const string& suffix);
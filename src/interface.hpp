@@ -32,6 +32,13 @@ struct CompilerOptions {
     bool shell;
     bool script;
     unsigned int max_reference_depth;
+    unsigned int jobs;
+    bool compositional;
+    bool partial_order;
+    bool symmetry;
+    unsigned int max_violations;
+    const char *external_dir;
+    const char *compose_algorithm;
     const char *script_file;
 
     static const int InputTypeFsp = 0;
@@ -0,0 +1,793 @@
+/*
+ *  fspc linear temporal logic properties
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ltl.hpp"
+#include "lts.hpp"
+#include "symbols_table.hpp"
+#include "state_table.hpp"
+
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <cctype>
+#include <assert.h>
+
+using namespace std;
+
+
+/* The operators of a formula. The ones following LtlRelease are only
+   produced by the parser, and they are removed by the conversion to
+   negation normal form. */
+enum {
+    LtlTrue, LtlFalse, LtlAtom, LtlNotAtom, LtlAnd, LtlOr, LtlNext,
+    LtlUntil, LtlRelease,
+    LtlNot, LtlImplies, LtlEquiv, LtlEventually, LtlAlways, LtlWeakUntil
+};
+
+struct LtlTerm {
+    int op;
+    unsigned int left;  /* The atom index, for LtlAtom and LtlNotAtom. */
+    unsigned int right;
+
+    LtlTerm(int o, unsigned int l, unsigned int r) : op(o), left(l),
+                                                     right(r) { }
+};
+
+
+/* ============================ LtlParser =========================== */
+/* A recursive descent parser for the syntax described in ltl.hpp. The
+   errors are reported throwing runtime_error. */
+class LtlParser {
+    const string& text;
+    unsigned int pos;
+    string token;   /* The current token, empty at the end. */
+    bool action;    /* Set if 'token' is an action label. */
+
+    void next();
+    bool accept(const string& t);
+    void expect(const string& t);
+    unsigned int add(int op, unsigned int left, unsigned int right);
+    unsigned int lookup(const string& label);
+    unsigned int binary(unsigned int level);
+    unsigned int unary();
+
+  public:
+    vector<LtlTerm> terms;
+    vector<fsp::ActionBitset> atoms;
+
+    LtlParser(const string& t) : text(t), pos(0), action(false) { }
+    unsigned int parse();
+};
+
+/* The binary operators, from the lowest precedence level to the
+   highest one. */
+static const char *binary_operators[] = { "<->", "->", "||", "&&", NULL };
+static const int binary_ops[] = { LtlEquiv, LtlImplies, LtlOr, LtlAnd };
+
+void LtlParser::next()
+{
+    static const char *symbols[] = { "<->", "<>", "->", "&&", "||", "[]",
+                                     "(", ")", "{", "}", ",", "!", NULL };
+
+    while (pos < text.size() && isspace(text[pos])) {
+        pos++;
+    }
+    token.clear();
+    action = false;
+    if (pos == text.size()) {
+        return;
+    }
+
+    for (unsigned int i = 0; symbols[i]; i++) {
+        if (text.compare(pos, string(symbols[i]).size(), symbols[i]) == 0) {
+            token = symbols[i];
+            pos += token.size();
+            return;
+        }
+    }
+
+    if (!isalpha(text[pos])) {
+        throw runtime_error(string("unexpected character '") + text[pos] +
+                            "'");
+    }
+    while (pos < text.size() && (isalnum(text[pos]) || text[pos] == '_' ||
+                                 text[pos] == '.' || text[pos] == '[' ||
+                                 text[pos] == ']')) {
+        token += text[pos++];
+    }
+    action = islower(token[0]) && token != "true" && token != "false";
+}
+
+bool LtlParser::accept(const string& t)
+{
+    if (!action && token == t) {
+        next();
+        return true;
+    }
+
+    return false;
+}
+
+void LtlParser::expect(const string& t)
+{
+    if (!accept(t)) {
+        throw runtime_error("'" + t + "' expected" +
+                            (token.size() ? " before '" + token + "'" : ""));
+    }
+}
+
+unsigned int LtlParser::add(int op, unsigned int left, unsigned int right)
+{
+    terms.push_back(LtlTerm(op, left, right));
+
+    return terms.size() - 1;
+}
+
+/* Return the index of the action 'label', which may use the square
+   brackets notation for the indexes (e.g. 'phil[1].eat'). */
+unsigned int LtlParser::lookup(const string& label)
+{
+    fsp::ActionsTable& at = fsp::ActionsTable::getref();
+    string normalized;
+    int index;
+
+    for (unsigned int i = 0; i < label.size(); i++) {
+        if (label[i] == '[') {
+            normalized += '.';
+        } else if (label[i] != ']') {
+            normalized += label[i];
+        }
+    }
+
+    index = at.lookup(normalized);
+    if (index < 0) {
+        throw runtime_error("unknown action '" + label + "'");
+    }
+
+    return index;
+}
+
+unsigned int LtlParser::unary()
+{
+    string t = token;
+    unsigned int ret;
+
+    if (action) {
+        atoms.push_back(fsp::ActionBitset());
+        atoms.back().insert(lookup(token));
+        next();
+        return add(LtlAtom, atoms.size() - 1, 0);
+    }
+    if (accept("{")) {
+        fsp::ActionBitset actions;
+
+        do {
+            if (!action) {
+                throw runtime_error("action expected" + (token.size() ?
+                                    " before '" + token + "'" : string()));
+            }
+            actions.insert(lookup(token));
+            next();
+        } while (accept(","));
+        expect("}");
+        atoms.push_back(actions);
+        return add(LtlAtom, atoms.size() - 1, 0);
+    }
+    if (accept("(")) {
+        ret = binary(0);
+        expect(")");
+        return ret;
+    }
+    if (accept("true")) {
+        return add(LtlTrue, 0, 0);
+    }
+    if (accept("false")) {
+        return add(LtlFalse, 0, 0);
+    }
+    if (accept("!")) {
+        return add(LtlNot, unary(), 0);
+    }
+    if (accept("X")) {
+        return add(LtlNext, unary(), 0);
+    }
+    if (accept("<>")) {
+        return add(LtlEventually, unary(), 0);
+    }
+    if (accept("[]")) {
+        return add(LtlAlways, unary(), 0);
+    }
+
+    throw runtime_error(t.size() ? "unexpected '" + t + "'" :
+                                   string("unexpected end of formula"));
+}
+
+/* Parse a formula whose binary operators have at least the precedence
+   'level'. All the operators are right associative. */
+unsigned int LtlParser::binary(unsigned int level)
+{
+    unsigned int left;
+
+    if (!binary_operators[level]) {
+        /* The temporal binary operators have the highest precedence. */
+        left = unary();
+        if (accept("U")) {
+            return add(LtlUntil, left, binary(level));
+        }
+        if (accept("W")) {
+            return add(LtlWeakUntil, left, binary(level));
+        }
+        if (accept("R")) {
+            return add(LtlRelease, left, binary(level));
+        }
+        return left;
+    }
+
+    left = binary(level + 1);
+    if (accept(binary_operators[level])) {
+        return add(binary_ops[level], left, binary(level));
+    }
+
+    return left;
+}
+
+unsigned int LtlParser::parse()
+{
+    unsigned int root;
+
+    next();
+    root = binary(0);
+    if (token.size()) {
+        throw runtime_error("unexpected '" + token + "'");
+    }
+
+    return root;
+}
+
+
+/* ========================== LtlTranslator ========================= */
+/* Translation of a formula into a generalized Büchi automaton, using
+   the tableau construction of Gerth, Peled, Vardi and Wolper ("Simple
+   on-the-fly automatic verification of linear temporal logic", 1995).
+   The formula is first converted into negation normal form, where the
+   subformulas are shared. */
+class LtlTranslator {
+    struct Node {
+        set<unsigned int> incoming;     /* 0 stands for the initial state. */
+        set<unsigned int> news;
+        set<unsigned int> old;
+        set<unsigned int> next;
+    };
+
+    const vector<fsp::ActionBitset>& atoms;
+    map< pair<int, pair<unsigned int, unsigned int> >, unsigned int> index;
+
+    unsigned int make(int op, unsigned int left, unsigned int right);
+    void label(const set<unsigned int>& old,
+               fsp::LtlProperty::State& state) const;
+    void expand(Node& node);
+
+  public:
+    /* The subformulas in negation normal form. */
+    vector<LtlTerm> nnf;
+
+    /* The nodes of the tableau (node i is the state i + 1). */
+    vector<Node> nodes;
+
+    LtlTranslator(const vector<fsp::ActionBitset>& a) : atoms(a) { }
+    unsigned int normalize(const vector<LtlTerm>& terms, unsigned int t,
+                           bool negated);
+    void translate(unsigned int root, fsp::LtlProperty& property);
+};
+
+unsigned int LtlTranslator::make(int op, unsigned int left,
+                                 unsigned int right)
+{
+    pair<int, pair<unsigned int, unsigned int> > key(op,
+                                                 make_pair(left, right));
+    map< pair<int, pair<unsigned int, unsigned int> >,
+         unsigned int>::iterator it = index.find(key);
+
+    if (it != index.end()) {
+        return it->second;
+    }
+    nnf.push_back(LtlTerm(op, left, right));
+    index[key] = nnf.size() - 1;
+
+    return nnf.size() - 1;
+}
+
+/* Convert the subformula 't' (negated if 'negated' is true) into
+   negation normal form, where the negations are only applied to the
+   atoms. */
+unsigned int LtlTranslator::normalize(const vector<LtlTerm>& terms,
+                                      unsigned int t, bool negated)
+{
+    const LtlTerm& f = terms[t];
+    unsigned int l, r;
+
+    switch (f.op) {
+    case LtlTrue:
+    case LtlFalse:
+        return make((f.op == LtlTrue) != negated ? LtlTrue : LtlFalse, 0, 0);
+
+    case LtlAtom:
+        return make(negated ? LtlNotAtom : LtlAtom, f.left, 0);
+
+    case LtlNot:
+        return normalize(terms, f.left, !negated);
+
+    case LtlAnd:
+    case LtlOr:
+        l = normalize(terms, f.left, negated);
+        r = normalize(terms, f.right, negated);
+        return make((f.op == LtlAnd) != negated ? LtlAnd : LtlOr, l, r);
+
+    case LtlImplies:
+        /* a -> b is !a || b. */
+        l = normalize(terms, f.left, !negated);
+        r = normalize(terms, f.right, negated);
+        return make(negated ? LtlAnd : LtlOr, l, r);
+
+    case LtlEquiv:
+        /* a <-> b is (a && b) || (!a && !b), and its negation is
+           (a && !b) || (!a && b). */
+        l = make(LtlAnd, normalize(terms, f.left, false),
+                 normalize(terms, f.right, negated));
+        r = make(LtlAnd, normalize(terms, f.left, true),
+                 normalize(terms, f.right, !negated));
+        return make(LtlOr, l, r);
+
+    case LtlNext:
+        return make(LtlNext, normalize(terms, f.left, negated), 0);
+
+    case LtlEventually:
+    case LtlAlways:
+        /* <> a is true U a, [] a is false R a. */
+        r = normalize(terms, f.left, negated);
+        if ((f.op == LtlEventually) != negated) {
+            return make(LtlUntil, make(LtlTrue, 0, 0), r);
+        }
+        return make(LtlRelease, make(LtlFalse, 0, 0), r);
+
+    case LtlUntil:
+    case LtlRelease:
+        l = normalize(terms, f.left, negated);
+        r = normalize(terms, f.right, negated);
+        return make((f.op == LtlUntil) != negated ? LtlUntil : LtlRelease,
+                    l, r);
+
+    case LtlWeakUntil:
+        /* a W b is b R (a || b), and its negation is !b U (!a && !b). */
+        l = normalize(terms, f.left, negated);
+        r = normalize(terms, f.right, negated);
+        if (negated) {
+            return make(LtlUntil, r, make(LtlAnd, l, r));
+        }
+        return make(LtlRelease, r, make(LtlOr, l, r));
+    }
+
+    assert(0);
+
+    return 0;
+}
+
+/* Compute the label of a node from the literals in 'old'. */
+void LtlTranslator::label(const set<unsigned int>& old,
+                          fsp::LtlProperty::State& state) const
+{
+    for (set<unsigned int>::const_iterator it = old.begin();
+                                            it != old.end(); it++) {
+        const LtlTerm& f = nnf[*it];
+
+        if (f.op == LtlAtom) {
+            if (state.any) {
+                state.allowed = atoms[f.left];
+                state.any = false;
+            } else {
+                state.allowed.intersect(atoms[f.left]);
+            }
+        } else if (f.op == LtlNotAtom) {
+            state.forbidden.unite(atoms[f.left]);
+        }
+    }
+}
+
+void LtlTranslator::expand(Node& node)
+{
+    unsigned int f;
+
+    if (node.news.empty()) {
+        fsp::LtlProperty::State state;
+        Node succ;
+
+        /* Drop the nodes that no action can enter. */
+        label(node.old, state);
+        if (!state.any && fsp::ActionBitset(state.allowed).subtract(
+                                        state.forbidden).empty()) {
+            return;
+        }
+
+        for (unsigned int i = 0; i < nodes.size(); i++) {
+            if (nodes[i].old == node.old && nodes[i].next == node.next) {
+                nodes[i].incoming.insert(node.incoming.begin(),
+                                         node.incoming.end());
+                return;
+            }
+        }
+        nodes.push_back(node);
+        succ.incoming.insert(nodes.size());
+        succ.news = node.next;
+        expand(succ);
+        return;
+    }
+
+    f = *node.news.begin();
+    node.news.erase(node.news.begin());
+    if (node.old.count(f)) {
+        expand(node);
+        return;
+    }
+
+    const LtlTerm t = nnf[f];
+    Node split;
+
+    node.old.insert(f);
+    switch (t.op) {
+    case LtlFalse:
+        return;
+
+    case LtlTrue:
+    case LtlAtom:
+    case LtlNotAtom:
+        expand(node);
+        return;
+
+    case LtlAnd:
+        node.news.insert(t.left);
+        node.news.insert(t.right);
+        expand(node);
+        return;
+
+    case LtlNext:
+        node.next.insert(t.left);
+        expand(node);
+        return;
+
+    case LtlOr:
+        split = node;
+        node.news.insert(t.left);
+        split.news.insert(t.right);
+        break;
+
+    case LtlUntil:
+        /* a U b holds if b holds now, or a holds now and a U b holds
+           from the next step. */
+        split = node;
+        node.news.insert(t.left);
+        node.next.insert(f);
+        split.news.insert(t.right);
+        break;
+
+    case LtlRelease:
+        /* a R b holds if b holds now and either a holds now or a R b
+           holds from the next step. */
+        split = node;
+        node.news.insert(t.right);
+        node.next.insert(f);
+        split.news.insert(t.left);
+        split.news.insert(t.right);
+        break;
+    }
+
+    expand(node);
+    expand(split);
+}
+
+/* Build the automaton of the formula 'root' into 'property', turning
+   the generalized Büchi automaton into a Büchi automaton. There is an
+   acceptance set for each until subformula a U b: the nodes where
+   either a U b does not hold or b holds. The states of the automaton
+   are pairs (node, c), where the counter c is the acceptance set to be
+   visited next: it is incremented when leaving a node of that set. The
+   accepting states are the ones of the first set, with counter 0. */
+void LtlTranslator::translate(unsigned int root, fsp::LtlProperty& property)
+{
+    vector<unsigned int> untils;
+    vector< vector<bool> > in_set;  /* in_set[i][j]: node i is in set j. */
+    unsigned int k;
+    Node init;
+
+    init.incoming.insert(0);
+    init.news.insert(root);
+    expand(init);
+
+    for (unsigned int i = 0; i < nnf.size(); i++) {
+        if (nnf[i].op == LtlUntil) {
+            untils.push_back(i);
+        }
+    }
+    k = max(untils.size(), size_t(1));
+
+    in_set.resize(nodes.size());
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (unsigned int j = 0; j < untils.size(); j++) {
+            const LtlTerm& u = nnf[untils[j]];
+
+            in_set[i].push_back(!nodes[i].old.count(untils[j]) ||
+                                nodes[i].old.count(u.right));
+        }
+    }
+
+    /* State 1 + i * k + c is the pair (node i, c). */
+    property.states.assign(1 + nodes.size() * k, fsp::LtlProperty::State());
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (unsigned int c = 0; c < k; c++) {
+            fsp::LtlProperty::State& state = property.states[1 + i * k + c];
+
+            label(nodes[i].old, state);
+            state.accepting = c == 0 && (untils.empty() || in_set[i][0]);
+        }
+    }
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (set<unsigned int>::iterator it = nodes[i].incoming.begin();
+                                    it != nodes[i].incoming.end(); it++) {
+            if (*it == 0) {
+                property.states[0].next.push_back(1 + i * k);
+                continue;
+            }
+            for (unsigned int c = 0; c < k; c++) {
+                unsigned int src = *it - 1;
+                unsigned int d = c;
+
+                if (untils.size() && in_set[src][c]) {
+                    d = (c + 1) % k;
+                }
+                property.states[1 + src * k + c].next.push_back(1 + i * k + d);
+            }
+        }
+    }
+}
+
+
+/* =========================== LtlProperty ========================== */
+bool fsp::LtlProperty::build(const string& text, string& error)
+{
+    LtlParser parser(text);
+    unsigned int root;
+
+    try {
+        root = parser.parse();
+    } catch (const runtime_error& e) {
+        error = e.what();
+        return false;
+    }
+
+    LtlTranslator translator(parser.atoms);
+
+    /* The automaton accepts the executions that violate the property,
+       so the formula is negated. */
+    root = translator.normalize(parser.terms, root, true);
+    formula = text;
+    states.clear();
+    translator.translate(root, *this);
+
+    return true;
+}
+
+
+/* ========================= Nested DFS ============================= */
+/* A transition of the product between an LTS and an automaton. */
+struct ProductEdge {
+    uint32_t dest;
+    uint32_t action;
+};
+
+/* A frame of the stacks of the nested DFS. The outgoing transitions
+   of 'state' are the ones in [first, end) in the edges array of the
+   stack, and 'next' is the next one to be examined. */
+struct ProductFrame {
+    uint32_t state;
+    uint32_t action;    /* The action that entered 'state'. */
+    size_t first;
+    size_t next;
+    size_t end;
+};
+
+/* The product of an LTS (explored through an LtsGenerator) and the
+   automaton of a property. The product states are pairs (LTS state,
+   automaton state), and they are generated on the fly. */
+struct Product {
+    const fsp::LtsGenerator& lts;
+    const fsp::LtlProperty& property;
+    fsp::StateTable table;
+    vector<uint8_t> flags;
+
+    static const uint8_t Cyan = 1;  /* On the stack of the first DFS. */
+    static const uint8_t Blue = 2;  /* Visited by the first DFS. */
+    static const uint8_t Red = 4;   /* Visited by the second DFS. */
+
+    Product(const fsp::LtsGenerator& l, const fsp::LtlProperty& p) :
+                                    lts(l), property(p), table(1024) { }
+
+    uint32_t insert(uint32_t state, uint32_t bstate) {
+        bool inserted;
+        uint32_t idx = table.insert((uint64_t(state) << 32) | bstate,
+                                    inserted);
+
+        if (inserted) {
+            flags.push_back(0);
+        }
+
+        return idx;
+    }
+    bool accepting(uint32_t idx) const {
+        return property.states[table.key(idx) & 0xffffffff].accepting;
+    }
+    void push(vector<ProductFrame>& stack, vector<ProductEdge>& edges,
+              uint32_t idx, uint32_t action);
+};
+
+/* Push the product state 'idx' on 'stack', appending its outgoing
+   transitions to 'edges'. */
+void Product::push(vector<ProductFrame>& stack, vector<ProductEdge>& edges,
+                   uint32_t idx, uint32_t action)
+{
+    uint64_t key = table.key(idx);
+    const fsp::LtlProperty::State& bstate =
+                                property.states[key & 0xffffffff];
+    ProductFrame frame;
+
+    frame.state = idx;
+    frame.action = action;
+    frame.first = frame.next = edges.size();
+
+    /* The edges of the LTS are only valid until the next call to
+       successors(), which is not called again here. */
+    EdgeRange children = lts.successors(key >> 32);
+
+    for (unsigned int i = 0; i < children.size(); i++) {
+        for (unsigned int j = 0; j < bstate.next.size(); j++) {
+            uint32_t b = bstate.next[j];
+
+            if (property.states[b].matches(children[i].action)) {
+                ProductEdge e;
+
+                e.dest = insert(children[i].dest, b);
+                e.action = children[i].action;
+                edges.push_back(e);
+            }
+        }
+    }
+    frame.end = edges.size();
+    stack.push_back(frame);
+}
+
+/* Look for a cycle through the accepting state 'seed', which is on
+   the top of the stack of the first DFS. The second DFS only visits
+   the states not visited by the previous second DFSs, and it stops as
+   soon as it reaches a state on the stack of the first DFS, since
+   that state can reach 'seed'. In that case 'red' is left with the
+   path from 'seed' to that state. */
+static bool red_dfs(Product& product, uint32_t seed,
+                    vector<ProductFrame>& red)
+{
+    vector<ProductEdge> edges;
+
+    product.flags[seed] |= Product::Red;
+    product.push(red, edges, seed, 0);
+    while (red.size()) {
+        ProductFrame& f = red.back();
+
+        if (f.next < f.end) {
+            ProductEdge e = edges[f.next++];
+
+            if (product.flags[e.dest] & Product::Cyan) {
+                ProductFrame last;
+
+                last.state = e.dest;
+                last.action = e.action;
+                last.first = last.next = last.end = edges.size();
+                red.push_back(last);
+                return true;
+            }
+            if (!(product.flags[e.dest] & Product::Red)) {
+                product.flags[e.dest] |= Product::Red;
+                product.push(red, edges, e.dest, e.action);
+            }
+            continue;
+        }
+        edges.resize(f.first);
+        red.pop_back();
+    }
+
+    return false;
+}
+
+/* Look for an infinite execution of the LTS that violates 'property',
+   i.e. an accepting cycle in the product between the LTS and the
+   automaton of the property. The product is explored on the fly with
+   the nested DFS of Courcoubetis, Vardi, Wolper and Yannakakis, in the
+   variant that marks the states on the stack of the first DFS (cyan
+   states), so that the search stops as soon as a cycle is closed. The
+   violation is reported as a lasso: a trace that reaches the cycle,
+   followed by the cycle. Only the infinite executions are considered:
+   deadlocks are reported by deadlockAnalysis(). Returns the number of
+   violations found (0 or 1). */
+int fsp::LtsGenerator::ltlAnalysis(const LtlProperty& property,
+                                   stringstream& ss) const
+{
+    fsp::ActionsTable& at = fsp::ActionsTable::getref();
+    Product product(*this, property);
+    vector<ProductFrame> blue;
+    vector<ProductFrame> red;
+    vector<ProductEdge> edges;
+    unsigned int k;
+
+    product.flags[product.insert(0, 0)] = Product::Cyan;
+    product.push(blue, edges, 0, 0);
+    while (blue.size()) {
+        ProductFrame& f = blue.back();
+
+        if (f.next < f.end) {
+            ProductEdge e = edges[f.next++];
+
+            if (!(product.flags[e.dest] & (Product::Cyan | Product::Blue))) {
+                product.flags[e.dest] |= Product::Cyan;
+                product.push(blue, edges, e.dest, e.action);
+            }
+            continue;
+        }
+
+        /* The visit of f.state is complete. */
+        if (product.accepting(f.state) && red_dfs(product, f.state, red)) {
+            break;
+        }
+        product.flags[f.state] &= ~Product::Cyan;
+        product.flags[f.state] |= Product::Blue;
+        edges.resize(f.first);
+        blue.pop_back();
+    }
+
+    if (blue.empty()) {
+        return 0;
+    }
+
+    /* The cycle goes from the last state of 'red' (which is on the
+       stack of the first DFS) to the seed along 'blue', and then back
+       along 'red'. */
+    for (k = 0; blue[k].state != red.back().state; k++) {
+    }
+    ss << "LTL property violation detected for process " << name
+        << " and property " << property.formula << ":\n";
+    ss << "	Trace to cycle: ";
+    for (unsigned int j = 1; j <= k; j++) {
+        ss << at.lookup(blue[j].action) << "-> ";
+    }
+    ss << "\n";
+    ss << "	Cycle: ";
+    for (unsigned int j = k + 1; j < blue.size(); j++) {
+        ss << at.lookup(blue[j].action) << "-> ";
+    }
+    for (unsigned int j = 1; j < red.size(); j++) {
+        ss << at.lookup(red[j].action) << "-> ";
+    }
+    ss << "\n\n";
+
+    return 1;
+}
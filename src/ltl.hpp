@@ -0,0 +1,88 @@
+/*
+ *  fspc linear temporal logic properties
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __LTL__HH
+#define __LTL__HH
+
+#include "action_bitset.hpp"
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+
+namespace fsp {
+
+/* A property of linear temporal logic over actions. The atomic
+   propositions are actions (or sets of actions): the proposition 'a'
+   holds at some point of an execution if the action executed there is
+   'a'. The syntax is
+
+       f ::= true | false | ACTION | { ACTION, ..., ACTION } | ( f )
+           | ! f | X f | <> f | [] f
+           | f && f | f || f | f -> f | f <-> f
+           | f U f | f W f | f R f
+
+   where the unary operators bind stronger than the binary ones, and
+   the binary ones are listed in order of decreasing precedence (the
+   temporal ones are right associative). ACTION is an action label
+   (e.g. 'phil.1.eat' or 'phil[1].eat').
+
+   The property is checked against the infinite executions of a
+   process: the formula is negated and translated into a Büchi
+   automaton, whose accepting runs are the executions that violate the
+   property (see LtsGenerator::ltlAnalysis()). */
+class LtlProperty {
+  public:
+    /* A state of the Büchi automaton. The state can only be entered
+       executing an action 'a' that satisfies its label, which is a
+       conjunction of literals: 'a' must be in 'allowed' (unless 'any'
+       is set) and must not be in 'forbidden'. */
+    struct State {
+        bool any;
+        ActionBitset allowed;
+        ActionBitset forbidden;
+        bool accepting;
+        vector<uint32_t> next;
+
+        State() : any(true), accepting(false) { }
+        bool matches(unsigned int action) const {
+            return (any || allowed.count(action)) &&
+                        !forbidden.count(action);
+        }
+    };
+
+    string formula;
+
+    /* The states of the automaton. State 0 is the initial state, which
+       is not accepting and has an empty label. */
+    vector<State> states;
+
+    /* Parse 'text' and build the automaton. Returns false (with a
+       description of the problem in 'error') if the formula is not
+       valid or it refers to unknown actions. */
+    bool build(const string& text, string& error);
+};
+
+}
+
+#endif
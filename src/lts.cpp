@@ -32,11 +32,19 @@
 /* Some helpers (intersection routines). */
 #include "helpers.hpp"
 
+/* Disk-backed sorting, for external memory composition. */
+#include "external_sort.hpp"
+
 #include <map>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
 #include <list>
 #include <queue>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include <cstdlib>
 #include <assert.h>
 
@@ -112,14 +120,15 @@ string ati(unsigned int index, bool square_ints)
 
 
 /* ====================== class Lts implementation ===================== */
-fsp::Lts::ComposeAlgorithm fsp::Lts::compose_algorithm =
-                                    &fsp::Lts::compose_operational;
+int fsp::Lts::compose_selection = fsp::Lts::ComposeAuto;
+unsigned int fsp::Lts::compose_jobs = 1;
+unsigned int fsp::Lts::parallel_bfs_states = 1 << 16;
+string fsp::Lts::external_dir;
+size_t fsp::Lts::external_memory = 256 << 20;
 
 int fsp::Lts::lookupAlphabet(unsigned int action) const
 {
-    set<unsigned int>::iterator it = alphabet.find(action);
-    
-    return (it == alphabet.end()) ? -1 : 0;
+    return alphabet.count(action) ? 0 : -1;
 }
 
 void fsp::Lts::updateAlphabet(unsigned int action)
@@ -129,12 +138,17 @@ void fsp::Lts::updateAlphabet(unsigned int action)
 
 void fsp::Lts::mergeAlphabetInto(set<unsigned int>& actions) const
 {
-    for (set<unsigned int>::iterator it = alphabet.begin();
+    for (ActionBitset::iterator it = alphabet.begin();
 			it != alphabet.end(); it++) {
 	actions.insert(*it);
     }
 }
 
+void fsp::Lts::mergeAlphabetInto(ActionBitset& actions) const
+{
+    actions.unite(alphabet);
+}
+
 void fsp::Lts::mergeAlphabetFrom(const set<unsigned int>& actions)
 {
     for (set<unsigned int>::iterator it = actions.begin();
@@ -143,6 +157,11 @@ void fsp::Lts::mergeAlphabetFrom(const set<unsigned int>& actions)
     }
 }
 
+void fsp::Lts::mergeAlphabetFrom(const ActionBitset& actions)
+{
+    alphabet.unite(actions);
+}
+
 void fsp::Lts::printAlphabet(stringstream& ss, bool compress) const
 {
     set<string> strings;
@@ -150,7 +169,7 @@ void fsp::Lts::printAlphabet(stringstream& ss, bool compress) const
     /* Lts::alphabet is a set of integers (index in the action
        table), and so it is sorted w.r.t. the integer values. However,
        here we want to print the action labels in lexycographic order. */
-    compress_action_labels(alphabet, strings, compress);
+    compress_action_labels(alphabet.toSet(), strings, compress);
 
     ss << "Alphabet: {";
     for (set<string>::iterator it = strings.begin();
@@ -180,12 +199,14 @@ void fsp::Lts::print() const
 
     at.print();
     cout << "LTS " << name << "\n";
-    for (unsigned int i=0; i<nodes.size(); i++) {
+    for (int i=0; i<numStates(); i++) {
+        EdgeRange children = edges(i);
+
 	cout << "State " << i << "(priv=" << get_priv(i) << ", type=" <<
             get_type(i) << "):\n";
-	for (unsigned int j=0; j<nodes[i].children.size(); j++)
-	    cout << "    " << ati(nodes[i].children[j].action, false)
-		    << " --> " << nodes[i].children[j].dest << "\n";
+	for (unsigned int j=0; j<children.size(); j++)
+	    cout << "    " << ati(children[j].action, false)
+		    << " --> " << children[j].dest << "\n";
     }
     printAlphabet(ss, false); cout << ss.str();
     cout << numStates() << " states, " << numTransitions() << " transitions\n";
@@ -194,6 +215,8 @@ void fsp::Lts::print() const
 void fsp::Lts::clear()
 {
     nodes.clear();
+    frozen.reset();
+    incoming.clear();
     infos.clear();
     alphabet.clear();
     terminal_sets.clear();
@@ -206,7 +229,7 @@ void fsp::Lts::cleanup()
 {
     bool search = (err == ~0U || end == ~0U);
 
-    for (unsigned int i = 0; search && i < nodes.size(); i++) {
+    for (int i = 0; search && i < numStates(); i++) {
         if (get_type(i) == LtsNode::End) {
             end = i;
             search = (err == ~0U);
@@ -222,6 +245,10 @@ int fsp::Lts::numTransitions() const
 {
     int n = 0;
 
+    if (frozen) {
+        return frozen->edges.size();
+    }
+
     for (unsigned int i=0; i<nodes.size(); i++) {
         for (unsigned int j=0; j<nodes[i].children.size(); j++) {
             n++;
@@ -233,14 +260,18 @@ int fsp::Lts::numTransitions() const
 
 void fsp::Lts::copy_node_in(int state, const Lts& lts, int i)
 {
-    nodes[state] = lts.nodes[i];
+    EdgeRange children = lts.edges(i);
+
+    nodes[state].children.assign(children.begin(), children.end());
     set_priv(state, lts.get_priv(i));
     set_type(state, lts.get_type(i));
 }
 
 void fsp::Lts::copy_node_out(Lts& lts, int i, int state)
 {
-    lts.nodes[i] = nodes[state];
+    EdgeRange children = edges(state);
+
+    lts.nodes[i].children.assign(children.begin(), children.end());
     lts.set_priv(i, get_priv(state));
     lts.set_type(i, get_type(state));
 }
@@ -248,18 +279,120 @@ void fsp::Lts::copy_node_out(Lts& lts, int i, int state)
 void fsp::Lts::copy_nodes_in(const Lts& lts)
 {
     nodes = lts.nodes;
+    frozen = lts.frozen;
     infos = lts.infos;
+    thaw();
+}
+
+/* Exchange the states and the transitions of *this and 'lts', so that
+   the graph of an LTS can be moved into another LTS without copying
+   it. The alphabets are not exchanged. */
+void fsp::Lts::swap_nodes(Lts& lts)
+{
+    nodes.swap(lts.nodes);
+    frozen.swap(lts.frozen);
+    infos.swap(lts.infos);
+    std::swap(end, lts.end);
+    std::swap(err, lts.err);
+    incoming.clear();
+    lts.incoming.clear();
+    terminal_sets_computed = lts.terminal_sets_computed = false;
+}
+
+void FrozenGraph::clear()
+{
+    /* Release the memory. */
+    vector<uint32_t>().swap(offsets);
+    vector<Edge>().swap(edges);
+}
+
+/* Move the transitions into the frozen layout. This is done when the
+   LTS is complete, since the frozen layout cannot be modified. */
+void fsp::Lts::freeze()
+{
+    unsigned int n = nodes.size();
+    shared_ptr<FrozenGraph> g;
+
+    if (frozen) {
+        return;
+    }
+
+    g = make_shared<FrozenGraph>();
+    g->offsets.resize(n + 1);
+    g->edges.reserve(numTransitions());
+    for (unsigned int i = 0; i < n; i++) {
+        g->offsets[i] = g->edges.size();
+        g->edges.insert(g->edges.end(), nodes[i].children.begin(),
+                        nodes[i].children.end());
+    }
+    g->offsets[n] = g->edges.size();
+    frozen = g;
+    vector<LtsNode>().swap(nodes);
+}
+
+/* Move the transitions back into 'nodes', so that they can be
+   modified. The frozen layout is released, and freed if it is not
+   shared with another LTS. */
+void fsp::Lts::thaw()
+{
+    unsigned int n;
+
+    /* Every modification starts here, so the predecessors of the
+       states may change. */
+    incoming.clear();
+    if (!frozen) {
+        return;
+    }
+
+    n = frozen->offsets.size() - 1;
+    nodes.resize(n);
+    for (unsigned int i = 0; i < n; i++) {
+        nodes[i].children.assign(
+                        frozen->edges.begin() + frozen->offsets[i],
+                        frozen->edges.begin() + frozen->offsets[i + 1]);
+    }
+    frozen.reset();
+}
+
+/* Replace the action of each transition with mapping[action]. Since
+   the structure of the LTS does not change, a frozen LTS is not thawed:
+   its transitions are copied only if they are shared with another LTS,
+   and are updated in place otherwise. */
+void fsp::Lts::remap_actions(const vector<uint32_t>& mapping)
+{
+    incoming.clear();
+
+    if (frozen) {
+        if (frozen.use_count() > 1) {
+            frozen = make_shared<FrozenGraph>(*frozen);
+        }
+        for (unsigned int i = 0; i < frozen->edges.size(); i++) {
+            frozen->edges[i].action = mapping[frozen->edges[i].action];
+        }
+        return;
+    }
+
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (unsigned int j = 0; j < nodes[i].children.size(); j++) {
+            nodes[i].children[j].action =
+                                    mapping[nodes[i].children[j].action];
+        }
+    }
 }
 
 /* BFS on the LTS for useless states removal. */
 void fsp::Lts::reduce(const fsp::Lts& unconnected)
 {
-    unsigned int np = unconnected.nodes.size();
+    unsigned int np = unconnected.numStates();
     queue<unsigned int> frontier;
     int *map = new int[np];
     int state;
     unsigned int n = 0;
 
+    /* The states change, so the symmetry reduction info is lost. */
+    symmetry.reset();
+    reduction.reset();
+
     if (!map) {
         cout << "Lts::reduce: map allocation failed\n";
         exit(EXIT_FAILURE);
@@ -267,6 +400,8 @@ void fsp::Lts::reduce(const fsp::Lts& unconnected)
 
     /* We make sure that 'nodes' is empty. */
     nodes.clear();
+    frozen.reset();
+    incoming.clear();
     terminal_sets_computed = false;
 
     if (!np) {
@@ -286,16 +421,18 @@ void fsp::Lts::reduce(const fsp::Lts& unconnected)
 	Edge e;
 
 	state = frontier.front();
+        EdgeRange children = unconnected.edges(state);
 
-	for (unsigned int j=0; j<unconnected.nodes[state].children.size(); j++) {
-	    int child = unconnected.nodes[state].children[j].dest;
+        nodes[map[state]].children.reserve(children.size());
+	for (unsigned int j=0; j<children.size(); j++) {
+	    int child = children[j].dest;
 
 	    if (map[child] == -1) {
 		map[child] = n++;
                 frontier.push(child);
 	    }
 	    e.dest = map[child];
-	    e.action = unconnected.nodes[state].children[j].action;
+	    e.action = children[j].action;
 	    nodes[map[state]].children.push_back(e);
 	}
 
@@ -333,9 +470,11 @@ void fsp::Lts::compose_declarative(const fsp::Lts& p, const fsp::Lts& q)
     product.nodes.resize(np *nq);
 
     /* Scan the P graph and combine P actions with Q states. */
-    for (unsigned int ip=0; ip<p.nodes.size(); ip++) {
-        for (unsigned int jp=0; jp<p.nodes[ip].children.size(); jp++) {
-            const Edge& ep = p.nodes[ip].children[jp];
+    for (unsigned int ip=0; ip<np; ip++) {
+        EdgeRange pchildren = p.edges(ip);
+
+        for (unsigned int jp=0; jp<pchildren.size(); jp++) {
+            const Edge& ep = pchildren[jp];
 
             /* We analyze an edge of P: (i, ep.action, ep.dest). */
             e.action = ep.action;
@@ -351,24 +490,28 @@ void fsp::Lts::compose_declarative(const fsp::Lts& p, const fsp::Lts& q)
             } else {
                 /* If ep.action is included in the alphabet of Q, this
                    action can be executed by P only together with Q. */
-                for (unsigned int iq=0; iq<q.nodes.size(); iq++)
-                    for (unsigned int jq=0; jq<q.nodes[iq].children.size(); jq++) {
-                        const Edge& eq = q.nodes[iq].children[jq];
+                for (unsigned int iq=0; iq<nq; iq++) {
+                    EdgeRange qchildren = q.edges(iq);
+
+                    for (unsigned int jq=0; jq<qchildren.size(); jq++) {
+                        const Edge& eq = qchildren[jq];
 
                         if (eq.action == ep.action) {
                             e.dest = ep.dest *nq + eq.dest;
                             product.nodes[ip*nq+iq].children.push_back(e);
                         }
                     }
-
+                }
             }
         }
     }
 
     /* Scan the Q graph and combine Q actions with P states */
-    for (unsigned int iq=0; iq<q.nodes.size(); iq++) {
-        for (unsigned int jq=0; jq<q.nodes[iq].children.size(); jq++) {
-            const Edge& eq = q.nodes[iq].children[jq];
+    for (unsigned int iq=0; iq<nq; iq++) {
+        EdgeRange qchildren = q.edges(iq);
+
+        for (unsigned int jq=0; jq<qchildren.size(); jq++) {
+            const Edge& eq = qchildren[jq];
 
             /* We analyze an edge of Q: (i, eq.action, eq.dest). */
             e.action = eq.action;
@@ -387,8 +530,8 @@ void fsp::Lts::compose_declarative(const fsp::Lts& p, const fsp::Lts& q)
 
     /* A composed state is an END state when both the components are
        END states. */
-    for (unsigned int ip=0; ip<p.nodes.size(); ip++) {
-        for (unsigned int iq=0; iq<q.nodes.size(); iq++)
+    for (unsigned int ip=0; ip<np; ip++) {
+        for (unsigned int iq=0; iq<nq; iq++)
             if ((p.get_type(ip) == LtsNode::Error) ||
                     (q.get_type(iq) == LtsNode::Error)) {
                 product.set_type(ip*nq+iq, LtsNode::Error);
@@ -404,21 +547,58 @@ void fsp::Lts::compose_declarative(const fsp::Lts& p, const fsp::Lts& q)
     reduce(product);
 }
 
+static bool edge_action_less(const Edge& e1, const Edge& e2)
+{
+    return e1.action < e2.action;
+}
+
+/* Build the action-indexed view of the edges of *this. */
+void fsp::Lts::indexActions(ActionIndex& ai) const
+{
+    unsigned int n = numStates();
+
+    ai.offsets.resize(n + 1);
+    ai.edges.clear();
+    ai.edges.reserve(numTransitions());
+
+    for (unsigned int i = 0; i < n; i++) {
+        EdgeRange children = edges(i);
+
+        ai.offsets[i] = ai.edges.size();
+        ai.edges.insert(ai.edges.end(), children.begin(), children.end());
+        stable_sort(ai.edges.begin() + ai.offsets[i], ai.edges.end(),
+                    edge_action_less);
+    }
+    ai.offsets[n] = ai.edges.size();
+
+    ai.alphabet = alphabet;
+}
+
+/* Return in [first, last) the edges of 'state' labeled with 'action'. */
+void ActionIndex::lookup(uint32_t state, uint32_t action,
+                         const Edge *& first, const Edge *& last) const
+{
+    const Edge *begin = edges.data() + offsets[state];
+    const Edge *end = edges.data() + offsets[state + 1];
+    pair<const Edge *, const Edge *> range;
+    Edge key;
+
+    key.action = action;
+    range = equal_range(begin, end, key, edge_action_less);
+    first = range.first;
+    last = range.second;
+}
+
 /* Helper function used by Lts::compose_operational(). */
 void fsp::Lts::update_composition(unsigned int idx,
                                unsigned int dst_ip, const fsp::Lts& p,
                                unsigned int dst_iq, const fsp::Lts& q,
-                               unsigned int nq, Edge& e,
-                               map<unsigned int, unsigned int>& direct,
-                               vector<unsigned int>& inverse)
+                               uint64_t nq, Edge& e, StateTable& direct)
 {
-    pair< map<unsigned int, unsigned int>::iterator, bool> insr;
-    pair<unsigned int, unsigned int> couple;
+    bool inserted;
 
-    couple.first = dst_ip*nq + dst_iq;
-    couple.second = nodes.size();
-    insr = direct.insert(couple);
-    if (insr.second) {
+    e.dest = direct.insert(dst_ip*nq + dst_iq, inserted);
+    if (inserted) {
         unsigned int type = LtsNode::Normal;
 
         if (p.get_type(dst_ip) == LtsNode::Error ||
@@ -430,70 +610,75 @@ void fsp::Lts::update_composition(unsigned int idx,
         }
         nodes.push_back(LtsNode());
         set_type(nodes.size() - 1, type);
-        inverse.push_back(couple.first);
     }
 
-    e.dest = insr.first->second;
     nodes[idx].children.push_back(e);
 }
 
 void fsp::Lts::compose_operational(const fsp::Lts& p, const fsp::Lts& q)
 {
-    unsigned int nq = q.numStates();
-    /* Maps '(ip, iq)' --> 'idx', where 'idx' is an index in the vector
-       'nodes' */
-    map<unsigned int, unsigned int> direct;
-    /* Maps 'idx' --> 'ip*nq + iq'. */
-    vector<unsigned int> inverse;
+    uint64_t np = p.numStates();
+    uint64_t nq = q.numStates();
+    /* Maps 'ip*nq + iq' --> 'idx', where 'idx' is an index in the vector
+       'nodes', and vice versa. We don't know how many composite states
+       are reachable, so we size the table with an estimate (linear in
+       the size of the operands) and let it grow when necessary. */
+    StateTable direct(min(np * nq, 4 * (np + nq)));
+    ActionIndex pi, qi;
     unsigned idx = 0;
     unsigned ip, iq;
+    bool inserted;
     Edge e;
 
+    /* Index the operands, so that the synchronization partners of an
+       edge can be found without scanning all the edges of a state. */
+    p.indexActions(pi);
+    q.indexActions(qi);
+
     /* First of all we reset *this, like Lts(ActionsTable *) would do. */
     nodes.clear();
+    frozen.reset();
+    incoming.clear();
     terminal_sets_computed = false;
     alphabet.clear();
     end = err = ~0U;
 
     nodes.push_back(LtsNode());
     set_type(nodes.size() - 1, LtsNode::Normal);
-    direct[0] = 0;
-    inverse.push_back(0);
+    direct.insert(0, inserted);
 
     while (idx < nodes.size()) {
-        ip = inverse[idx] / nq;
-        iq = inverse[idx] % nq;
+        ip = direct.key(idx) / nq;
+        iq = direct.key(idx) % nq;
+
+        EdgeRange pchildren = p.edges(ip);
+        EdgeRange qchildren = q.edges(iq);
 
-        for (unsigned int jp = 0; jp < p.nodes[ip].children.size(); jp++) {
-            const Edge& ep = p.nodes[ip].children[jp];
+        for (unsigned int jp = 0; jp < pchildren.size(); jp++) {
+            const Edge& ep = pchildren[jp];
 
             e.action = ep.action;
-            if (q.lookupAlphabet(ep.action) == -1) {
+            if (!qi.inAlphabet(ep.action)) {
                 update_composition(idx, ep.dest, p,
-                                   iq, q, nq, e, direct,
-                                   inverse);
+                                   iq, q, nq, e, direct);
             } else {
-                for (unsigned int jq = 0; jq < q.nodes[iq].children.size();
-                                                                jq++) {
-                    const Edge& eq = q.nodes[iq].children[jq];
-
-                    if (eq.action == ep.action) {
-                        update_composition(idx, ep.dest, p,
-                                           eq.dest, q,
-                                           nq, e, direct, inverse);
-                    }
+                const Edge *eq, *last;
+
+                for (qi.lookup(iq, ep.action, eq, last); eq != last;
+                                                                eq++) {
+                    update_composition(idx, ep.dest, p,
+                                       eq->dest, q, nq, e, direct);
                 }
             }
         }
 
-        for (unsigned int jq = 0; jq < q.nodes[iq].children.size(); jq++) {
-            const Edge& eq = q.nodes[iq].children[jq];
+        for (unsigned int jq = 0; jq < qchildren.size(); jq++) {
+            const Edge& eq = qchildren[jq];
 
             e.action = eq.action;
-            if (p.lookupAlphabet(eq.action) == -1) {
+            if (!pi.inAlphabet(eq.action)) {
                 update_composition(idx, ip, p, eq.dest,
-                                   q, nq, e, direct,
-                                   inverse);
+                                   q, nq, e, direct);
             }
         }
 
@@ -504,117 +689,2118 @@ void fsp::Lts::compose_operational(const fsp::Lts& p, const fsp::Lts& q)
     mergeAlphabetFrom(q.alphabet);
 }
 
-void fsp::Lts::compose(const fsp::Lts& p, const fsp::Lts& q)
+/* The synchronous product of n LTSs, used by the N-ary composition
+   engines. The composite states are tuples (s1, s2, ..., sn). */
+class fsp::NaryProduct {
+    const vector<const Lts *>& ltsv;
+    unsigned int n;
+
+    /* 'prefix[k]' is the alphabet of the partial product of the LTSs
+       ltsv[0], ..., ltsv[k-1]. */
+    vector<ActionBitset> prefix;
+
+    /* The action-indexed views of the operands. */
+    vector<ActionIndex> index;
+
+    /* True if no edge of an operand is labeled with an action in the
+       alphabet of another operand, so that the product is a pure
+       interleaving (e.g. the result of a multi-label labeling). */
+    bool interleaving;
+
+    /* Partial order reduction support: 'owners[a]' contains the
+       components having the action 'a' in their alphabet, while
+       'critical' marks the components that contain Error states. */
+    bool por;
+    vector< vector<unsigned int> > owners;
+    vector<bool> critical;
+    unsigned int num_critical;
+
+  public:
+    /* The outgoing edges of a composite state, stored as an array of
+       actions and an array of destination tuples (n elements each).
+       Each thread using successors() needs its own instance. */
+    struct Edges {
+        vector<uint32_t> actions;
+        vector<uint32_t> dests;
+        vector<uint32_t> next_actions;
+        vector<uint32_t> next_dests;
+    };
+
+  private:
+    bool enabled(const uint32_t *tuple, unsigned int action) const;
+    void stubborn(const uint32_t *tuple, unsigned int seed,
+                  vector<bool>& set, unsigned int& size) const;
+    void reduce(const uint32_t *tuple, Edges& out) const;
+
+  public:
+
+    NaryProduct(const vector<const Lts *>& v, bool reduction);
+    unsigned int width() const { return n; }
+    bool isInterleaving() const { return interleaving; }
+    uint64_t estimate() const;
+    void successors(const uint32_t *tuple, Edges& out) const;
+    unsigned int type(const uint32_t *tuple) const;
+};
+
+fsp::NaryProduct::NaryProduct(const vector<const fsp::Lts *>& v,
+                              bool reduction)
+                    : ltsv(v), n(v.size()), prefix(v.size()),
+                      index(v.size()), interleaving(true), por(reduction),
+                      critical(v.size(), false), num_critical(0)
 {
-    (this->*compose_algorithm)(p, q);
+    assert(n);
+
+    for (unsigned int k = 0; k < n; k++) {
+        ltsv[k]->indexActions(index[k]);
+        if (k) {
+            prefix[k] = prefix[k - 1];
+            prefix[k].unite(index[k - 1].alphabet);
+        }
+    }
+
+    /* 'owner[a]' is the operand having 'a' in its alphabet, or -1 if
+       no operand has it, or -2 if more than one operand has it. */
+    vector<int> owner;
+
+    for (unsigned int k = 0; k < n; k++) {
+        const ActionBitset& alpha = index[k].alphabet;
+
+        if (owner.size() < alpha.bound()) {
+            owner.resize(alpha.bound(), -1);
+        }
+        for (ActionBitset::iterator it = alpha.begin();
+                                        it != alpha.end(); it++) {
+            owner[*it] = owner[*it] == -1 ? int(k) : -2;
+        }
+    }
+    for (unsigned int k = 0; interleaving && k < n; k++) {
+        const vector<Edge>& edges = index[k].edges;
+
+        for (unsigned int i = 0; i < edges.size(); i++) {
+            unsigned int a = edges[i].action;
+
+            if (a < owner.size() && owner[a] != -1 &&
+                                    owner[a] != int(k)) {
+                interleaving = false;
+                break;
+            }
+        }
+    }
+
+    for (unsigned int k = 0; por && k < n; k++) {
+        const ActionBitset& alpha = index[k].alphabet;
+
+        if (owners.size() < alpha.bound()) {
+            owners.resize(alpha.bound());
+        }
+        for (ActionBitset::iterator it = alpha.begin();
+                                        it != alpha.end(); it++) {
+            owners[*it].push_back(k);
+        }
+        for (int i = 0; i < ltsv[k]->numStates(); i++) {
+            if (ltsv[k]->get_type(i) == LtsNode::Error) {
+                critical[k] = true;
+                num_critical++;
+                break;
+            }
+        }
+    }
 }
 
-fsp::Lts::Lts(const fsp::Lts& p, const fsp::Lts& q)
+/* An estimate of the number of composite states, linear in the size of
+   the operands (see compose_operational()). An interleaving product
+   reaches all the combinations of the operands states, so in that
+   case the estimate is exact (unless too large). */
+uint64_t fsp::NaryProduct::estimate() const
 {
-    compose(p, q);
-    refcount = 0;
-    DBR(delegated = 0);
+    const uint64_t MaxExact = 1 << 24;
+    uint64_t estimate = 0;
+    uint64_t product = 1;
+
+    for (unsigned int k = 0; k < n; k++) {
+        estimate += ltsv[k]->numStates();
+        product = min(product * ltsv[k]->numStates(), MaxExact);
+    }
+
+    return interleaving ? max(product, 4 * estimate) : 4 * estimate;
 }
 
-fsp::Lts& fsp::Lts::compose(const fsp::Lts& q)
+/* Compute the outgoing edges of the composite state 'tuple'. The edges
+   are generated in the same order the pairwise fold (with
+   compose_operational) would generate them. */
+void fsp::NaryProduct::successors(const uint32_t *tuple, Edges& out) const
 {
-    fsp::Lts copy(*this);
+    const fsp::Lts& p = *ltsv[0];
+    EdgeRange np = p.edges(tuple[0]);
+
+    out.actions.clear();
+    out.dests.clear();
+
+    if (interleaving) {
+        /* No synchronization is possible: the fold would generate the
+           edges of each operand in turn. */
+        for (unsigned int k = 0; k < n; k++) {
+            EdgeRange nk = ltsv[k]->edges(tuple[k]);
+
+            for (unsigned int j = 0; j < nk.size(); j++) {
+                out.actions.push_back(nk[j].action);
+                out.dests.insert(out.dests.end(), tuple, tuple + n);
+                out.dests[out.dests.size() - n + k] = nk[j].dest;
+            }
+        }
+        if (por) {
+            reduce(tuple, out);
+        }
+
+        return;
+    }
 
-    compose(copy, q);
+    for (unsigned int jp = 0; jp < np.size(); jp++) {
+        const Edge& ep = np[jp];
 
-    return *this;
+        out.actions.push_back(ep.action);
+        out.dests.insert(out.dests.end(), tuple, tuple + n);
+        out.dests[out.dests.size() - n] = ep.dest;
+    }
+
+    /* Compose the partial product with ltsv[k], one component at
+       a time, like compose_operational() does. */
+    for (unsigned int k = 1; k < n; k++) {
+        const ActionIndex& qi = index[k];
+        EdgeRange nq = ltsv[k]->edges(tuple[k]);
+        const vector<uint32_t>& actions = out.actions;
+        const vector<uint32_t>& dests = out.dests;
+        vector<uint32_t>& next_actions = out.next_actions;
+        vector<uint32_t>& next_dests = out.next_dests;
+
+        next_actions.clear();
+        next_dests.clear();
+        for (unsigned int i = 0; i < actions.size(); i++) {
+            if (!qi.inAlphabet(actions[i])) {
+                next_actions.push_back(actions[i]);
+                next_dests.insert(next_dests.end(),
+                                  dests.begin() + i * n,
+                                  dests.begin() + (i + 1) * n);
+            } else {
+                const Edge *eq, *last;
+
+                for (qi.lookup(tuple[k], actions[i], eq, last);
+                                                eq != last; eq++) {
+                    next_actions.push_back(eq->action);
+                    next_dests.insert(next_dests.end(),
+                                      dests.begin() + i * n,
+                                      dests.begin() + (i + 1) * n);
+                    next_dests[next_dests.size() - n + k] = eq->dest;
+                }
+            }
+        }
+
+        for (unsigned int jq = 0; jq < nq.size(); jq++) {
+            const Edge& eq = nq[jq];
+
+            if (!prefix[k].count(eq.action)) {
+                next_actions.push_back(eq.action);
+                next_dests.insert(next_dests.end(), tuple, tuple + n);
+                next_dests[next_dests.size() - n + k] = eq.dest;
+            }
+        }
+
+        out.actions.swap(next_actions);
+        out.dests.swap(next_dests);
+    }
+
+    if (por) {
+        reduce(tuple, out);
+    }
 }
 
-int fsp::Lts::deadlockAnalysis(stringstream& ss) const
+/* Return true if the (non local) action 'action' is enabled in the
+   composite state 'tuple', that is if all the components having
+   'action' in their alphabet can execute it. */
+bool fsp::NaryProduct::enabled(const uint32_t *tuple,
+                               unsigned int action) const
 {
-    unsigned int nd = 0;
-    unsigned int n = nodes.size();
-    queue<unsigned int> frontier;
-    unsigned int *actions; /* The action used to reach frontier[i] */
-    unsigned int *back;    /* Backpointer of frontier[i] */
-    vector<bool> seen(n);  /* seen[i] is set if state i has been enqueued */
-    unsigned int *action_trace;
-    unsigned int push_idx, pop_idx;
+    const vector<unsigned int>& comps = owners[action];
 
-    if (!n) {
-        return 0;
+    for (unsigned int j = 0; j < comps.size(); j++) {
+        const Edge *first, *last;
+
+        index[comps[j]].lookup(tuple[comps[j]], action, first, last);
+        if (first == last) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Compute a stubborn set of components for the composite state 'tuple',
+   starting from the component 'seed'. The set is closed under these
+   rules:
+     - if an action of a component in the set is enabled, all the
+       components that synchronize on that action are in the set;
+     - if an action of a component in the set is disabled, one of the
+       components that currently cannot execute it is in the set.
+   The transitions of the components outside the set are independent
+   of the transitions of the components in the set, and cannot enable
+   them, so that exploring only the latter preserves the reachability
+   of the states without outgoing transitions (deadlocks and END
+   states). The components that can reach an Error state are always
+   in the set, so that property violations are preserved, too. */
+void fsp::NaryProduct::stubborn(const uint32_t *tuple, unsigned int seed,
+                                vector<bool>& set, unsigned int& size) const
+{
+    vector<unsigned int> frontier;
+
+    set = critical;
+    size = num_critical;
+    for (unsigned int k = 0; k < n; k++) {
+        if (set[k]) {
+            frontier.push_back(k);
+        }
+    }
+    if (!set[seed]) {
+        set[seed] = true;
+        size++;
+        frontier.push_back(seed);
+    }
+
+    while (frontier.size()) {
+        unsigned int i = frontier.back();
+        EdgeRange node = ltsv[i]->edges(tuple[i]);
+
+        frontier.pop_back();
+        for (unsigned int j = 0; j < node.size(); j++) {
+            unsigned int action = node[j].action;
+            const vector<unsigned int> *comps;
+            bool en;
+
+            if (action >= owners.size() || owners[action].size() < 2) {
+                /* A local action: it only involves component 'i'. */
+                continue;
+            }
+            comps = &owners[action];
+            en = enabled(tuple, action);
+
+            for (unsigned int k = 0; k < comps->size(); k++) {
+                unsigned int c = (*comps)[k];
+                bool add = true;
+
+                if (!en) {
+                    /* Add only the first component that must move
+                       before 'action' can be enabled. */
+                    const Edge *first, *last;
+
+                    index[c].lookup(tuple[c], action, first, last);
+                    add = (first == last);
+                }
+                if (add && !set[c]) {
+                    set[c] = true;
+                    size++;
+                    frontier.push_back(c);
+                }
+                if (add && !en) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Partial order reduction: remove from 'out' the edges that are not
+   generated by the smallest stubborn set of components. */
+void fsp::NaryProduct::reduce(const uint32_t *tuple, Edges& out) const
+{
+    vector<bool> best, set;
+    unsigned int best_size = n + 1;
+    unsigned int size;
+    unsigned int k = 0;
+
+    /* Try all the components that take part in an enabled edge as
+       seeds, and keep the smallest stubborn set. */
+    for (unsigned int i = 0; i < out.actions.size() && best_size > 1; i++) {
+        const uint32_t *dest = &out.dests[i * n];
+        unsigned int action = out.actions[i];
+        unsigned int seed = n;
+
+        if (action < owners.size() && owners[action].size()) {
+            seed = owners[action][0];
+        } else {
+            for (unsigned int j = 0; j < n && seed == n; j++) {
+                if (dest[j] != tuple[j]) {
+                    seed = j;
+                }
+            }
+        }
+        if (seed == n || (best.size() && best[seed])) {
+            continue;
+        }
+        stubborn(tuple, seed, set, size);
+        if (size < best_size) {
+            best.swap(set);
+            best_size = size;
+        }
+    }
+
+    if (best_size >= n) {
+        /* No reduction is possible. */
+        return;
+    }
+
+    /* Keep the edges of the components in the stubborn set. Local
+       self-loops are always kept, since they are harmless. */
+    for (unsigned int i = 0; i < out.actions.size(); i++) {
+        const uint32_t *dest = &out.dests[i * n];
+        unsigned int action = out.actions[i];
+        bool keep = true;
+
+        if (action < owners.size() && owners[action].size()) {
+            keep = best[owners[action][0]];
+        } else {
+            for (unsigned int j = 0; j < n; j++) {
+                if (dest[j] != tuple[j]) {
+                    keep = best[j];
+                    break;
+                }
+            }
+        }
+        if (keep) {
+            out.actions[k] = action;
+            copy(dest, dest + n, out.dests.begin() + k * n);
+            k++;
+        }
+    }
+    out.actions.resize(k);
+    out.dests.resize(k * n);
+}
+
+/* Compute the type of the composite state 'tuple', in the same way
+   the pairwise fold would do. Note that compose_operational() always
+   marks the initial state of each intermediate product as Normal. */
+unsigned int fsp::NaryProduct::type(const uint32_t *tuple) const
+{
+    unsigned int type = ltsv[0]->get_type(tuple[0]);
+    bool initial = (tuple[0] == 0);
+
+    for (unsigned int k = 1; k < n; k++) {
+        unsigned int tk = ltsv[k]->get_type(tuple[k]);
+
+        initial = initial && (tuple[k] == 0);
+        if (initial) {
+            type = LtsNode::Normal;
+        } else if (type == LtsNode::Error || tk == LtsNode::Error) {
+            type = LtsNode::Error;
+        } else if (type == LtsNode::End && tk == LtsNode::End) {
+            type = LtsNode::End;
+        } else {
+            type = LtsNode::Normal;
+        }
+    }
+
+    return type;
+}
+
+/* Report a violation found by the on-the-fly safety check, using the
+   same format used by deadlockAnalysis(). */
+static void report_violation(fsp::SafetyCheck& check,
+                             const vector<Edge>& parent, unsigned int state,
+                             const char *ed)
+{
+    vector<unsigned int> trace;
+
+    check.report << ed << " found for process " << check.name
+                    << ": state " << state << "\n";
+    /* Follow the parent pointers to build the trace (in reverse
+       order). */
+    for (unsigned int s = state; s; s = parent[s].dest) {
+        trace.push_back(parent[s].action);
+    }
+    check.report << "	Trace to " << ed << ": ";
+    for (unsigned int j = trace.size(); j > 0; j--) {
+        check.report << ati(trace[j - 1], false) << "->";
+    }
+    check.report << "\n\n";
+    check.found++;
+}
+
+/* N-ary parallel composition of the LTSs in 'ltsv'. The composite
+   states are explored directly as tuples (s1, s2, ..., sn), so that
+   the intermediate products of the pairwise fold
+   ((P1 || P2) || P3) || ... are never built.
+   Since the outgoing edges of each tuple are generated in the same
+   order the pairwise fold would generate them, and states are
+   numbered in BFS discovery order, the resulting LTS is identical to
+   the one produced by the fold.
+   The visited tuples are stored in a TreeTable, so that the memory
+   used per state stays almost constant when the number of components
+   grows.
+   If 'reduction' is true, partial order reduction is applied (see
+   NaryProduct::stubborn()).
+   If 'check' is not NULL, deadlocks and Error states are reported as
+   soon as they are found, and the exploration is stopped when the
+   maximum number of violations is reached. In this case the resulting
+   LTS is incomplete. */
+void fsp::Lts::compose_nary(const vector<const fsp::Lts *>& ltsv,
+                            bool reduction, SafetyCheck *check)
+{
+    NaryProduct product(ltsv, reduction);
+    unsigned int n = product.width();
+    vector<uint32_t> sizes(n);
+
+    for (unsigned int k = 0; k < n; k++) {
+        sizes[k] = ltsv[k]->numStates();
+    }
+
+    TreeTable direct(sizes, product.estimate());
+    vector<uint32_t> tuple(n, 0);
+    NaryProduct::Edges edges;
+    /* BFS parent pointers: 'parent[i].dest' is the state that discovered
+       state i, and 'parent[i].action' is the action used. */
+    vector<Edge> parent;
+    unsigned idx = 0;
+    bool inserted;
+    Edge e;
+
+    /* First of all we reset *this, like Lts(ActionsTable *) would do. */
+    nodes.clear();
+    frozen.reset();
+    incoming.clear();
+    terminal_sets_computed = false;
+    alphabet.clear();
+    end = err = ~0U;
+
+    nodes.push_back(LtsNode());
+    set_type(nodes.size() - 1, LtsNode::Normal);
+    direct.insert(&tuple[0], inserted);
+
+    if (check) {
+        /* The initial state has no parent. */
+        parent.push_back(Edge());
+    }
+
+    while (idx < nodes.size() && !(check && check->stopped())) {
+        direct.key(idx, &tuple[0]);
+        product.successors(&tuple[0], edges);
+
+        for (unsigned int i = 0; i < edges.actions.size(); i++) {
+            const uint32_t *dest = &edges.dests[i * n];
+
+            e.action = edges.actions[i];
+            e.dest = direct.insert(dest, inserted);
+            if (inserted) {
+                unsigned int type = product.type(dest);
+
+                nodes.push_back(LtsNode());
+                set_type(nodes.size() - 1, type);
+                if (check) {
+                    parent.push_back(Edge());
+                    parent.back().dest = idx;
+                    parent.back().action = e.action;
+                    if (type == LtsNode::Error && !check->stopped()) {
+                        report_violation(*check, parent, e.dest,
+                                         "Property violation");
+                    }
+                }
+            }
+            nodes[idx].children.push_back(e);
+        }
+
+        if (check && edges.actions.empty() && !check->stopped() &&
+                                        get_type(idx) == LtsNode::Normal) {
+            report_violation(*check, parent, idx, "Deadlock");
+        }
+
+        idx++;
+    }
+
+    for (unsigned int k = 0; k < n; k++) {
+        mergeAlphabetFrom(ltsv[k]->alphabet);
+    }
+}
+
+/* Per-instance working memory of LazyLts, including the cache of the
+   outgoing edges of the last expanded states. */
+struct fsp::LazyLts::Scratch {
+    NaryProduct::Edges edges;
+    vector<uint32_t> tuple;
+    vector<Edge> out;
+    map< uint32_t, vector<Edge> > cache;
+    deque<uint32_t> order;  /* Cached states, oldest first. */
+};
+
+unsigned int fsp::LazyLts::cache_states = 1 << 16;
+
+fsp::LazyLts::LazyLts(const vector< fsp::SmartPtr<fsp::Lts> >& v)
+                    : components(v), scratch(new Scratch)
+{
+    vector<uint32_t> sizes;
+    bool inserted;
+
+    assert(v.size());
+    for (unsigned int k = 0; k < v.size(); k++) {
+        ltsv.push_back(v[k]);
+        sizes.push_back(v[k]->numStates());
+        v[k]->mergeAlphabetInto(alphabet);
     }
 
-    actions = new unsigned int[n];
-    back = new unsigned int[n];
-    action_trace = new unsigned int [n];
+    product = new NaryProduct(ltsv, false);
+    table = new TreeTable(sizes, min(product->estimate(), uint64_t(1024)));
+    scratch->tuple.assign(ltsv.size(), 0);
+    table->insert(&scratch->tuple[0], inserted);
+}
+
+fsp::LazyLts::~LazyLts()
+{
+    delete scratch;
+    delete table;
+    delete product;
+}
+
+unsigned int fsp::LazyLts::discovered() const
+{
+    return table->size();
+}
+
+/* Compute the outgoing edges of 'state', assigning an index to the
+   composite states not discovered yet. */
+EdgeRange fsp::LazyLts::successors(unsigned int state) const
+{
+    unsigned int n = ltsv.size();
+    map< uint32_t, vector<Edge> >::iterator it;
+    bool inserted;
+    Edge e;
+
+    it = scratch->cache.find(state);
+    if (it != scratch->cache.end()) {
+        return it->second;
+    }
+
+    table->key(state, &scratch->tuple[0]);
+    product->successors(&scratch->tuple[0], scratch->edges);
+
+    scratch->out.clear();
+    for (unsigned int i = 0; i < scratch->edges.actions.size(); i++) {
+        e.action = scratch->edges.actions[i];
+        if (e.action < hidden.size() && hidden[e.action]) {
+            e.action = 0;
+        }
+        e.dest = table->insert(&scratch->edges.dests[i * n], inserted);
+        scratch->out.push_back(e);
+    }
+
+    if (!cache_states) {
+        return scratch->out;
+    }
+
+    /* Evict the oldest cached state, if necessary. */
+    while (scratch->order.size() >= cache_states) {
+        scratch->cache.erase(scratch->order.front());
+        scratch->order.pop_front();
+    }
+    scratch->order.push_back(state);
+    it = scratch->cache.insert(make_pair(state, vector<Edge>())).first;
+    it->second.swap(scratch->out);
+
+    return it->second;
+}
+
+unsigned int fsp::LazyLts::stateType(unsigned int state) const
+{
+    table->key(state, &scratch->tuple[0]);
+
+    return product->type(&scratch->tuple[0]);
+}
+
+/* Hide the 'actions', like Lts::hiding() does on the composite LTS. */
+fsp::LazyLts& fsp::LazyLts::hiding(const set<unsigned int>& actions)
+{
+    for (set<unsigned int>::const_iterator it = actions.begin();
+                                            it != actions.end(); it++) {
+        if (alphabet.erase(*it)) {
+            if (hidden.size() <= *it) {
+                hidden.resize(*it + 1, false);
+            }
+            hidden[*it] = true;
+        }
+    }
+    scratch->cache.clear();
+    scratch->order.clear();
+
+    return *this;
+}
+
+/* A work queue owned by a parallel composition worker. The owner pushes
+   and pops work items at the back, while the other workers steal work
+   items from the front. A work item is a composite state index
+   followed by the composite state tuple. */
+struct ComposeDeque {
+    mutex lock;
+    deque<uint32_t> items;
+
+    void push(const uint32_t *item, unsigned int size);
+    bool pop(uint32_t *item, unsigned int size, bool steal);
+};
+
+void ComposeDeque::push(const uint32_t *item, unsigned int size)
+{
+    lock_guard<mutex> guard(lock);
+
+    items.insert(items.end(), item, item + size);
+}
+
+bool ComposeDeque::pop(uint32_t *item, unsigned int size, bool steal)
+{
+    lock_guard<mutex> guard(lock);
+
+    if (items.empty()) {
+        return false;
+    }
+
+    if (steal) {
+        copy(items.begin(), items.begin() + size, item);
+        items.erase(items.begin(), items.begin() + size);
+    } else {
+        copy(items.end() - size, items.end(), item);
+        items.erase(items.end() - size, items.end());
+    }
+
+    return true;
+}
+
+/* The transitions produced by a parallel composition worker: the
+   edges of 'states[i]' are in [offsets[i], offsets[i+1]). */
+struct ComposeOutput {
+    vector<uint32_t> states;
+    vector<uint32_t> offsets;
+    vector<Edge> edges;
+
+    /* (state, type) pairs for the states that are not Normal. */
+    vector< pair<uint32_t, uint32_t> > types;
+
+    ComposeOutput() : offsets(1, 0) { }
+};
+
+/* The state shared by the parallel composition workers. */
+struct ComposeShared {
+    const fsp::NaryProduct& product;
+    fsp::ConcurrentTupleTable& table;
+    vector<ComposeDeque *> deques;
+    vector<ComposeOutput> outputs;
+
+    /* Number of work items pushed but not processed yet. */
+    atomic<uint64_t> pending;
+
+    ComposeShared(const fsp::NaryProduct& p, fsp::ConcurrentTupleTable& t,
+                  unsigned int jobs) : product(p), table(t),
+                                       outputs(jobs), pending(0) { }
+};
+
+static void compose_worker(ComposeShared *shared, unsigned int id)
+{
+    unsigned int jobs = shared->deques.size();
+    unsigned int n = shared->product.width();
+    ComposeOutput& out = shared->outputs[id];
+    fsp::NaryProduct::Edges edges;
+    vector<uint32_t> item(n + 1);
+    vector<uint32_t> work(n + 1);
+    bool inserted;
+    Edge e;
+
+    for (;;) {
+        bool found = shared->deques[id]->pop(&item[0], n + 1, false);
+
+        /* Our own queue is empty: try to steal some work. */
+        for (unsigned int k = 1; !found && k < jobs; k++) {
+            found = shared->deques[(id + k) % jobs]->pop(&item[0], n + 1,
+                                                         true);
+        }
+
+        if (!found) {
+            if (shared->pending == 0) {
+                break;
+            }
+            this_thread::yield();
+            continue;
+        }
+
+        shared->product.successors(&item[1], edges);
+        for (unsigned int i = 0; i < edges.actions.size(); i++) {
+            const uint32_t *dest = &edges.dests[i * n];
+
+            e.action = edges.actions[i];
+            e.dest = shared->table.insert(dest, inserted);
+            if (inserted) {
+                unsigned int type = shared->product.type(dest);
+
+                if (type != LtsNode::Normal) {
+                    out.types.push_back(make_pair(e.dest, type));
+                }
+                shared->pending++;
+                work[0] = e.dest;
+                copy(dest, dest + n, work.begin() + 1);
+                shared->deques[id]->push(&work[0], n + 1);
+            }
+            out.edges.push_back(e);
+        }
+        out.states.push_back(item[0]);
+        out.offsets.push_back(out.edges.size());
+
+        /* Only now the work item is done, after its successors have
+           been pushed. */
+        shared->pending--;
+    }
+}
+
+/* Multi-threaded version of compose_nary(). The composite states are
+   explored by 'compose_jobs' workers: each worker pulls states from
+   its own queue (or steals them from the other workers' queues),
+   inserts the successors in a concurrent state table and stores the
+   transitions into a private buffer. The buffers are merged at the
+   end. Since the states are discovered in a nondeterministic order,
+   the result is renumbered in BFS order: in this way the output is
+   identical to the one produced by compose_nary(). */
+void fsp::Lts::compose_parallel(const vector<const fsp::Lts *>& ltsv,
+                                bool reduction)
+{
+    unsigned int jobs = compose_jobs;
+    NaryProduct product(ltsv, reduction);
+    unsigned int n = product.width();
+    ConcurrentTupleTable table(n, 64 * jobs, product.estimate());
+    ComposeShared shared(product, table, jobs);
+    vector<uint32_t> item(n + 1, 0);
+    vector<thread> workers;
+    Lts unconnected;
+    bool inserted;
+
+    assert(jobs > 1);
+
+    /* First of all we reset *this, like Lts(ActionsTable *) would do. */
+    nodes.clear();
+    frozen.reset();
+    incoming.clear();
+    terminal_sets_computed = false;
+    alphabet.clear();
+    end = err = ~0U;
+
+    /* The initial state gets index 0. */
+    item[0] = table.insert(&item[1], inserted);
+    for (unsigned int i = 0; i < jobs; i++) {
+        shared.deques.push_back(new ComposeDeque);
+    }
+    shared.pending = 1;
+    shared.deques[0]->push(&item[0], n + 1);
+
+    for (unsigned int i = 1; i < jobs; i++) {
+        workers.push_back(thread(compose_worker, &shared, i));
+    }
+    compose_worker(&shared, 0);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    /* Merge the per-worker buffers. */
+    unconnected.nodes.resize(table.size());
+    for (unsigned int i = 0; i < jobs; i++) {
+        ComposeOutput& out = shared.outputs[i];
+
+        for (unsigned int j = 0; j < out.states.size(); j++) {
+            unconnected.nodes[out.states[j]].children.assign(
+                                out.edges.begin() + out.offsets[j],
+                                out.edges.begin() + out.offsets[j + 1]);
+        }
+        for (unsigned int j = 0; j < out.types.size(); j++) {
+            unconnected.set_type(out.types[j].first, out.types[j].second);
+        }
+        delete shared.deques[i];
+    }
+    shared.outputs.clear();
+
+    reduce(unconnected);
+
+    for (unsigned int k = 0; k < n; k++) {
+        mergeAlphabetFrom(ltsv[k]->alphabet);
+    }
+}
+
+/* Compare the composite state tuples at the beginning of two records. */
+static int tuple_compare(const uint32_t *a, const uint32_t *b, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+/* External memory version of compose_nary(). The composite states are
+   explored level by level (BFS), and the set of visited states is not
+   kept in memory, but in a file sorted by tuple, stored in the
+   'external_dir' directory. Duplicate detection is delayed: the
+   successors of a whole level are collected and sorted on disk, and
+   then merged against the visited states file. The transitions are
+   resolved in the same way, so that only the resulting LTS is kept in
+   memory.
+   At each level, the new states are numbered in order of first
+   discovery, so that the numbering (and the result) is identical to
+   the one of compose_nary(). The following record files are used
+   ('n' is the number of components, 'seq' a 64 bit sequence number
+   of a transition within the level, split in two words):
+     - frontier: the tuples of the current level, in index order;
+     - visited: (tuple, index), sorted;
+     - candidates: (tuple, seq, source, action), one per transition;
+     - fresh: (seq, tuple), the new states with their first discovery;
+     - resolved: (seq, source, action, index), one per transition. */
+void fsp::Lts::compose_external(const vector<const fsp::Lts *>& ltsv,
+                                bool reduction)
+{
+    NaryProduct product(ltsv, reduction);
+    unsigned int n = product.width();
+    size_t memory = external_memory / 4;
+    RecordFile *frontier = new RecordFile(external_dir, n);
+    RecordFile *visited = new RecordFile(external_dir, n + 1);
+    vector<uint32_t> tuple(n + 1, 0);
+    NaryProduct::Edges edges;
+    uint32_t level_first = 0;
+    uint32_t level_count = 1;
+
+    /* First of all we reset *this, like Lts(ActionsTable *) would do. */
+    nodes.clear();
+    frozen.reset();
+    incoming.clear();
+    terminal_sets_computed = false;
+    alphabet.clear();
+    end = err = ~0U;
+
+    nodes.push_back(LtsNode());
+    set_type(0, LtsNode::Normal);
+    frontier->write(&tuple[0]);
+    visited->write(&tuple[0]);
+
+    while (level_count) {
+        RecordSorter candidates(external_dir, n + 4, memory);
+        RecordSorter fresh(external_dir, n + 2, memory);
+        RecordSorter entered(external_dir, n + 1, memory);
+        RecordSorter resolved(external_dir, 5, memory);
+        RecordFile *sorted = new RecordFile(external_dir, n + 4);
+        RecordFile *next_frontier = new RecordFile(external_dir, n);
+        RecordFile *next_visited = new RecordFile(external_dir, n + 1);
+        vector<uint32_t> rec(n + 4), vis(n + 1), f(n + 2), prev;
+        bool vis_valid;
+        uint64_t seq = 0;
+
+        /* Expand the current level. */
+        frontier->rewind();
+        for (uint32_t s = level_first; s < level_first + level_count; s++) {
+            frontier->read(&tuple[0]);
+            product.successors(&tuple[0], edges);
+            for (unsigned int i = 0; i < edges.actions.size(); i++) {
+                copy(edges.dests.begin() + i * n,
+                     edges.dests.begin() + (i + 1) * n, rec.begin());
+                rec[n] = seq >> 32;
+                rec[n + 1] = seq & 0xffffffff;
+                rec[n + 2] = s;
+                rec[n + 3] = edges.actions[i];
+                candidates.add(&rec[0]);
+                seq++;
+            }
+        }
+        candidates.finish();
+
+        /* Merge the sorted candidates against the visited states, to
+           find the new states. The candidates are also saved, sorted,
+           for the second merge. */
+        visited->rewind();
+        vis_valid = visited->read(&vis[0]);
+        while (candidates.next(&rec[0])) {
+            sorted->write(&rec[0]);
+            if (prev.size() && tuple_compare(&prev[0], &rec[0], n) == 0) {
+                /* Not the first discovery: the candidates with the same
+                   tuple are sorted by 'seq'. */
+                continue;
+            }
+            prev.assign(rec.begin(), rec.begin() + n);
+            while (vis_valid && tuple_compare(&vis[0], &rec[0], n) < 0) {
+                vis_valid = visited->read(&vis[0]);
+            }
+            if (vis_valid && tuple_compare(&vis[0], &rec[0], n) == 0) {
+                /* Already visited. */
+                continue;
+            }
+            f[0] = rec[n];
+            f[1] = rec[n + 1];
+            copy(rec.begin(), rec.begin() + n, f.begin() + 2);
+            fresh.add(&f[0]);
+        }
+        fresh.finish();
+
+        /* Number the new states in order of first discovery. */
+        level_first += level_count;
+        level_count = 0;
+        while (fresh.next(&f[0])) {
+            uint32_t idx = nodes.size();
+
+            if (idx == ~0U) {
+                /* LTS state indexes are 32 bit wide. */
+                cerr << "compose_external: too many states\n";
+                exit(EXIT_FAILURE);
+            }
+            nodes.push_back(LtsNode());
+            set_type(idx, product.type(&f[2]));
+            next_frontier->write(&f[2]);
+            copy(f.begin() + 2, f.end(), vis.begin());
+            vis[n] = idx;
+            entered.add(&vis[0]);
+            level_count++;
+        }
+        entered.finish();
+
+        /* Merge the new states into the visited states. */
+        {
+            vector<uint32_t> e(n + 1);
+            bool e_valid = entered.next(&e[0]);
+
+            visited->rewind();
+            vis_valid = visited->read(&vis[0]);
+            while (vis_valid || e_valid) {
+                if (!e_valid || (vis_valid &&
+                            tuple_compare(&vis[0], &e[0], n) < 0)) {
+                    next_visited->write(&vis[0]);
+                    vis_valid = visited->read(&vis[0]);
+                } else {
+                    next_visited->write(&e[0]);
+                    e_valid = entered.next(&e[0]);
+                }
+            }
+        }
+        delete visited;
+        visited = next_visited;
+        delete frontier;
+        frontier = next_frontier;
+
+        /* Resolve the destination of each transition, merging the
+           sorted candidates against the visited states. */
+        sorted->rewind();
+        visited->rewind();
+        vis_valid = visited->read(&vis[0]);
+        while (sorted->read(&rec[0])) {
+            uint32_t r[5];
+
+            while (tuple_compare(&vis[0], &rec[0], n) < 0) {
+                vis_valid = visited->read(&vis[0]);
+                assert(vis_valid);
+            }
+            r[0] = rec[n];
+            r[1] = rec[n + 1];
+            r[2] = rec[n + 2];
+            r[3] = rec[n + 3];
+            r[4] = vis[n];
+            resolved.add(r);
+        }
+        delete sorted;
+        resolved.finish();
+
+        /* Append the transitions, in the order they were generated. */
+        {
+            uint32_t r[5];
+            Edge e;
+
+            while (resolved.next(r)) {
+                e.action = r[3];
+                e.dest = r[4];
+                nodes[r[2]].children.push_back(e);
+            }
+        }
+    }
+    delete frontier;
+    delete visited;
+
+    for (unsigned int k = 0; k < n; k++) {
+        mergeAlphabetFrom(ltsv[k]->alphabet);
+    }
+}
+
+/* Set the composition algorithm by name ("auto", "declarative" or
+   "operational"). Return false if the name is not valid. */
+bool fsp::Lts::setComposeAlgorithm(const string& name)
+{
+    if (name == "auto") {
+        compose_selection = ComposeAuto;
+    } else if (name == "declarative") {
+        compose_selection = ComposeDeclarative;
+    } else if (name == "operational") {
+        compose_selection = ComposeOperational;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/* Choose the algorithm to compose 'p' and 'q'. In automatic mode, the
+   cost of both algorithms is estimated from the state counts, the edge
+   counts and the alphabet overlap, in units of the time needed to
+   append an edge to a node:
+     - compose_declarative() allocates all the np*nq composite states,
+       replicates each local edge of P (Q) for every state of Q (P), and
+       matches each synchronizing edge of P against all the edges of Q;
+     - compose_operational() only visits the reachable states, but pays
+       a hash table lookup for each generated edge. The reachable
+       fraction of the np*nq states is estimated from the fraction of
+       local edges, since synchronizing edges constrain the product.
+   The weights have been measured on the composition of the test
+   models.
+   The declarative algorithm is never used when np*nq is too large,
+   since it could exhaust the memory, nor when the user asked for
+   parallel or external memory composition. */
+fsp::Lts::ComposeAlgorithm fsp::Lts::select_algorithm(const fsp::Lts& p,
+                                                      const fsp::Lts& q)
+{
+    const uint64_t MaxDeclarativeStates = 1 << 22;
+    const double CellCost = 3.0;        /* Per declarative state. */
+    const double ScanCost = 0.03;       /* Per synchronization match. */
+    const double StateCost = 2.8;       /* Per operational state. */
+    const double EdgeCost = 1.5;        /* Per operational edge. */
+    uint64_t np = p.numStates();
+    uint64_t nq = q.numStates();
+    uint64_t p_local = 0, p_sync = 0, q_local = 0, q_sync = 0;
+    double declarative, operational, density, degree;
+
+    if (compose_selection == ComposeDeclarative) {
+        return &Lts::compose_declarative;
+    }
+    if (compose_selection == ComposeOperational || external_dir.size() ||
+                        compose_jobs > 1 || np * nq > MaxDeclarativeStates) {
+        return &Lts::compose_operational;
+    }
+
+    for (unsigned int i = 0; i < np; i++) {
+        EdgeRange children = p.edges(i);
+
+        for (unsigned int j = 0; j < children.size(); j++) {
+            if (q.alphabet.count(children[j].action)) {
+                p_sync++;
+            } else {
+                p_local++;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < nq; i++) {
+        EdgeRange children = q.edges(i);
+
+        for (unsigned int j = 0; j < children.size(); j++) {
+            if (p.alphabet.count(children[j].action)) {
+                q_sync++;
+            } else {
+                q_local++;
+            }
+        }
+    }
+
+    declarative = CellCost * np * nq + p_local * nq + q_local * np +
+                    ScanCost * p_sync * (q_local + q_sync);
+
+    density = 1.0;
+    if (p_local + p_sync + q_local + q_sync) {
+        density = double(p_local + q_local) /
+                            (p_local + p_sync + q_local + q_sync);
+    }
+    degree = (np ? double(p_local + p_sync) / np : 0.0) +
+                (nq ? double(q_local + q_sync) / nq : 0.0);
+    operational = max(double(max(np, nq)), 0.5 * density * np * nq) *
+                    (StateCost + EdgeCost * degree);
+
+    return declarative < operational ? &Lts::compose_declarative :
+                                       &Lts::compose_operational;
+}
+
+/* Composition of LTSs that never synchronize with each other (e.g. the
+   relabeled copies created by a multi-label labeling). All the
+   combinations of the operands states are reachable, so each composite
+   state is identified by its mixed radix code, and a dense array maps
+   codes to state indexes, replacing the hash table used by
+   compose_nary(). The result is identical to the one produced by
+   compose_nary(), which is used when the operands do synchronize or
+   when the dense array would be too large. */
+void fsp::Lts::compose_interleaving(const vector<const fsp::Lts *>& ltsv)
+{
+    const uint64_t MaxInterleavingStates = 1 << 26;
+    NaryProduct product(ltsv, false);
+    unsigned int n = product.width();
+    vector<uint64_t> stride(n);
+    vector<uint32_t> tuple(n);
+    uint64_t total = 1;
+
+    for (unsigned int k = n; k > 0; k--) {
+        stride[k - 1] = total;
+        total *= ltsv[k - 1]->numStates();
+        if (total > MaxInterleavingStates) {
+            break;
+        }
+    }
+
+    if (!product.isInterleaving() || total > MaxInterleavingStates) {
+        if (compose_jobs > 1) {
+            compose_parallel(ltsv, false);
+        } else {
+            compose_nary(ltsv, false, NULL);
+        }
+        return;
+    }
+
+    /* 'ids[c]' is the index of the composite state whose code is 'c',
+       while 'codes[i]' is the code of the composite state 'i'. */
+    vector<uint32_t> ids(total, ~0U);
+    vector<uint64_t> codes;
+    unsigned int idx = 0;
+    Edge e;
+
+    /* First of all we reset *this, like Lts(ActionsTable *) would do. */
+    nodes.clear();
+    frozen.reset();
+    incoming.clear();
+    terminal_sets_computed = false;
+    alphabet.clear();
+    end = err = ~0U;
+
+    nodes.reserve(total);
+    codes.reserve(total);
+    nodes.push_back(LtsNode());
+    set_type(0, LtsNode::Normal);
+    codes.push_back(0);
+    ids[0] = 0;
+
+    while (idx < nodes.size()) {
+        uint64_t code = codes[idx];
+
+        for (unsigned int k = 0; k < n; k++) {
+            tuple[k] = (code / stride[k]) % ltsv[k]->numStates();
+        }
+
+        for (unsigned int k = 0; k < n; k++) {
+            EdgeRange nk = ltsv[k]->edges(tuple[k]);
+
+            for (unsigned int j = 0; j < nk.size(); j++) {
+                uint64_t dest = code + (uint64_t(nk[j].dest) -
+                                        tuple[k]) * stride[k];
+
+                if (ids[dest] == ~0U) {
+                    uint32_t saved = tuple[k];
+
+                    ids[dest] = nodes.size();
+                    codes.push_back(dest);
+                    tuple[k] = nk[j].dest;
+                    nodes.push_back(LtsNode());
+                    set_type(nodes.size() - 1, product.type(&tuple[0]));
+                    tuple[k] = saved;
+                }
+                e.action = nk[j].action;
+                e.dest = ids[dest];
+                nodes[idx].children.push_back(e);
+            }
+        }
+
+        idx++;
+    }
+
+    for (unsigned int k = 0; k < n; k++) {
+        mergeAlphabetFrom(ltsv[k]->alphabet);
+    }
+}
+
+/* Composition of the components of 'sym', with symmetry reduction:
+   each composite state is replaced by the canonical representative of
+   its orbit, so that only one state for each orbit is explored. The
+   representatives are stored in 'sym.table'. */
+void fsp::Lts::compose_symmetric(Symmetry& sym)
+{
+    vector<const Lts *> ltsv;
+
+    for (unsigned int k = 0; k < sym.components.size(); k++) {
+        ltsv.push_back(sym.components[k]);
+    }
+
+    NaryProduct product(ltsv, false);
+    unsigned int n = product.width();
+    vector<uint32_t> sizes(n);
+
+    for (unsigned int k = 0; k < n; k++) {
+        sizes[k] = ltsv[k]->numStates();
+    }
+
+    delete sym.table;
+    sym.table = new TreeTable(sizes, product.estimate());
+
+    TreeTable& reps = *sym.table;
+    vector<uint32_t> tuple(n, 0);
+    vector<uint32_t> rep(n);
+    NaryProduct::Edges edges;
+    unsigned idx = 0;
+    bool inserted;
+    Edge e;
+
+    /* First of all we reset *this, like Lts(ActionsTable *) would do. */
+    nodes.clear();
+    frozen.reset();
+    incoming.clear();
+    terminal_sets_computed = false;
+    alphabet.clear();
+    end = err = ~0U;
+
+    nodes.push_back(LtsNode());
+    set_type(nodes.size() - 1, LtsNode::Normal);
+    reps.insert(&tuple[0], inserted);
+
+    while (idx < nodes.size()) {
+        reps.key(idx, &tuple[0]);
+        product.successors(&tuple[0], edges);
+
+        for (unsigned int i = 0; i < edges.actions.size(); i++) {
+            const uint32_t *dest = &edges.dests[i * n];
+
+            rep.assign(dest, dest + n);
+            sym.canonical(&rep[0]);
+            e.action = edges.actions[i];
+            e.dest = reps.insert(&rep[0], inserted);
+            if (inserted) {
+                nodes.push_back(LtsNode());
+                set_type(nodes.size() - 1, product.type(&rep[0]));
+            }
+            nodes[idx].children.push_back(e);
+        }
+
+        idx++;
+    }
+
+    for (unsigned int k = 0; k < n; k++) {
+        mergeAlphabetFrom(ltsv[k]->alphabet);
+    }
+}
+
+/* Map the 'path' of states of a symmetry reduced LTS (starting from
+   the initial state) onto the LTS without reduction, computing the
+   concrete 'trace' of actions and the 'last' composite state reached.
+   At each step, the first concrete edge leading to the next orbit is
+   followed. The actions hidden after the composition are mapped to
+   tau. */
+void fsp::Lts::symmetric_trace(const vector<unsigned int>& path,
+                               vector<unsigned int>& trace,
+                               vector<uint32_t>& last) const
+{
+    const Symmetry& sym = *symmetry;
+    vector<const Lts *> ltsv;
+
+    for (unsigned int k = 0; k < sym.components.size(); k++) {
+        ltsv.push_back(sym.components[k]);
+    }
+
+    NaryProduct product(ltsv, false);
+    unsigned int n = product.width();
+    vector<uint32_t> rep(n);
+    NaryProduct::Edges edges;
+
+    trace.clear();
+    last.assign(n, 0);
+    for (unsigned int i = 1; i < path.size(); i++) {
+        unsigned int j;
+
+        product.successors(&last[0], edges);
+        for (j = 0; j < edges.actions.size(); j++) {
+            const uint32_t *dest = &edges.dests[j * n];
+
+            rep.assign(dest, dest + n);
+            sym.canonical(&rep[0]);
+            if (sym.table->lookup(&rep[0]) == path[i]) {
+                break;
+            }
+        }
+        assert(j < edges.actions.size());
+        trace.push_back(alphabet.count(edges.actions[j]) ?
+                        edges.actions[j] : 0);
+        last.assign(&edges.dests[j * n], &edges.dests[(j + 1) * n]);
+    }
+}
+
+/* Collect the actions of the edges reachable from the composite state
+   'start' in the LTS without symmetry reduction. */
+void fsp::Lts::symmetric_actions(const vector<uint32_t>& start,
+                                 ActionBitset& actions) const
+{
+    const Symmetry& sym = *symmetry;
+    vector<const Lts *> ltsv;
+
+    for (unsigned int k = 0; k < sym.components.size(); k++) {
+        ltsv.push_back(sym.components[k]);
+    }
+
+    NaryProduct product(ltsv, false);
+    unsigned int n = product.width();
+    TupleTable visited(n, 64);
+    NaryProduct::Edges edges;
+    vector<uint32_t> tuple(n);
+    bool inserted;
+
+    actions.clear();
+    visited.insert(&start[0], inserted);
+    for (uint32_t idx = 0; idx < visited.size(); idx++) {
+        tuple.assign(visited.key(idx), visited.key(idx) + n);
+        product.successors(&tuple[0], edges);
+        for (unsigned int j = 0; j < edges.actions.size(); j++) {
+            actions.insert(alphabet.count(edges.actions[j]) ?
+                           edges.actions[j] : 0);
+            visited.insert(&edges.dests[j * n], inserted);
+        }
+    }
+}
+
+void fsp::Lts::compose(const fsp::Lts& p, const fsp::Lts& q)
+{
+    ComposeAlgorithm algorithm = select_algorithm(p, q);
+
+    if (algorithm == &Lts::compose_operational &&
+                        (external_dir.size() || compose_jobs > 1)) {
+        vector<const Lts *> v;
+
+        v.push_back(&p);
+        v.push_back(&q);
+        if (external_dir.size()) {
+            compose_external(v, false);
+        } else {
+            compose_parallel(v, false);
+        }
+    } else {
+        (this->*algorithm)(p, q);
+    }
+}
+
+fsp::Lts::Lts(const fsp::Lts& p, const fsp::Lts& q)
+{
+    compose(p, q);
+    refcount = 0;
+    DBR(delegated = 0);
+}
+
+fsp::Lts::Lts(const vector< fsp::SmartPtr<fsp::Lts> >& ltsv, bool partial_order,
+              SafetyCheck *check)
+{
+    vector<const Lts *> v;
+
+    for (unsigned int k = 0; k < ltsv.size(); k++) {
+        v.push_back(ltsv[k]);
+    }
+
+    if (v.size() > 1 && check) {
+        /* The on-the-fly check needs the states to be explored in BFS
+           order, which is only done by the sequential engine. */
+        compose_nary(v, partial_order, check);
+    } else if (v.size() > 1 && compose_selection != ComposeDeclarative) {
+        /* The N-ary engines never build the intermediate products, so
+           they are preferred to a pairwise fold in automatic mode. */
+        if (external_dir.size()) {
+            compose_external(v, partial_order);
+        } else if (compose_jobs > 1) {
+            compose_parallel(v, partial_order);
+        } else {
+            compose_nary(v, partial_order, NULL);
+        }
+    } else {
+        partial_order = false;
+        /* Pairwise fold (partial order reduction is not supported). */
+        assert(v.size());
+        if (v.size() == 1) {
+            copy_nodes_in(*v[0]);
+            alphabet = v[0]->alphabet;
+            terminal_sets_computed = false;
+            end = v[0]->end;
+            err = v[0]->err;
+        } else {
+            compose(*v[0], *v[1]);
+        }
+        for (unsigned int k = 2; k < v.size(); k++) {
+            /* Move the intermediate product out of *this, which is
+               overwritten by the next composition. */
+            fsp::Lts p;
+
+            p.swap_nodes(*this);
+            p.alphabet.swap(alphabet);
+            compose(p, *v[k]);
+        }
+    }
+    if (partial_order) {
+        /* The reduced LTS only preserves deadlocks and Error states:
+           keep the components, to compute the LTS without reduction
+           when something else is needed. */
+        reduction = make_shared<Reduction>(ltsv);
+    }
+    refcount = 0;
+    DBR(delegated = 0);
+}
+
+fsp::Lts::Lts(const shared_ptr<Symmetry>& sym)
+{
+    compose_symmetric(*sym);
+    symmetry = sym;
+    reduction = sym;
+    refcount = 0;
+    DBR(delegated = 0);
+}
+
+fsp::Lts& fsp::Lts::compose(const fsp::Lts& q)
+{
+    fsp::Lts p;
+    bool self = (&q == this);
+
+    /* *this is overwritten by the composition, so its content is moved
+       into 'p' rather than copied. */
+    p.swap_nodes(*this);
+    p.alphabet.swap(alphabet);
+    symmetry.reset();
+    reduction.reset();
+    compose(p, self ? p : q);
+
+    return *this;
+}
+
+/* Map a trace of a symmetry reduced LTS, visiting the states in 'path',
+   onto a trace of the LTS without reduction. */
+void fsp::Lts::concrete_trace(const vector<unsigned int>& path,
+                              vector<unsigned int>& trace) const
+{
+    vector<uint32_t> last;
+
+    if (symmetry) {
+        symmetric_trace(path, trace, last);
+    }
+}
+
+/* Report the deadlock (or Error) 'state', reached with the actions in
+   'trace' along the states in 'path'. */
+void fsp::LtsGenerator::report_deadlock(stringstream& ss, unsigned int state,
+                                        vector<unsigned int>& path,
+                                        vector<unsigned int>& trace) const
+{
+    string ed;
+
+    if (stateType(state) == LtsNode::Normal)
+        ed = "Deadlock";
+    else
+        ed = "Property violation";
+    ss << ed << " found for process " << name << ": state "
+                    << state << "\n";
+    /* Reduced LTSs replace the trace with the concrete one. */
+    concrete_trace(path, trace);
+    ss << "	Trace to " << ed << ": ";
+    for (unsigned int i = 0; i < trace.size(); i++)
+        ss << ati(trace[i], false) << "->";
+    ss << "\n\n";
+}
+
+int fsp::LtsGenerator::deadlockAnalysis(stringstream& ss) const
+{
+    unsigned int nd = 0;
+    queue<unsigned int> frontier;
+    vector<unsigned int> actions; /* The action used to reach frontier[i] */
+    vector<unsigned int> back;    /* Backpointer of frontier[i] */
+    vector<bool> seen;  /* seen[i] is set if state i has been enqueued */
+    vector<unsigned int> action_trace;
+    unsigned int pop_idx;
+
+    if (!discovered()) {
+        return 0;
+    }
+
+    /* BFS looking for states with no outgoing transitions. We use a BFS
+       instead of a DFS because the former is simpler to implement and
+       because it finds the shortest path to each deadlock state.
+       The states may be discovered while exploring (see LazyLts), so
+       the arrays grow with the frontier. */
+
+    /* Initialize a queue that only contains the 0 node. */
+    frontier.push(0);
+    pop_idx = 0;
+    seen.push_back(true);
+    actions.push_back(0);
+    back.push_back(0);
+
+    /* Keep visiting until the queue is empty. */
+    do {
+        unsigned int state;
+	unsigned int i;
+
+	/* Pop a state and examine all its children. */
+	state = frontier.front();
+        EdgeRange children = successors(state);
+
+        if (seen.size() < discovered()) {
+            seen.resize(discovered(), false);
+        }
+	for (i=0; i<children.size(); i++) {
+	    int child = children[i].dest;
+
+	    if (!seen[child]) {
+		seen[child] = true;
+		back.push_back(state);
+		actions.push_back(children[i].action);
+                frontier.push(child);
+	    }
+	}
+
+	/* No outgoing transitions ==> Deadlock state */
+	if (i == 0 && stateType(state) != LtsNode::End) {
+	    unsigned int t;
+            vector<unsigned int> path;
+
+	    /* Starting from 'state', we follow the backpointers to build the
+	       trace to deadlock (in reverse order). */
+            action_trace.clear();
+	    for (t = pop_idx; t; t = back[t]) {
+		action_trace.push_back(actions[t]);
+                path.push_back(t);
+	    }
+            path.push_back(0);
+            reverse(action_trace.begin(), action_trace.end());
+            reverse(path.begin(), path.end());
+            report_deadlock(ss, state, path, action_trace);
+	    nd++;
+	}
+        frontier.pop();
+        pop_idx++;
+    } while (!frontier.empty());
+
+    return nd;
+}
+
+/* Return the incoming edges of 'state' (the 'dest' field of each edge
+   is the source state). The predecessor index is built on the first
+   call, with a counting sort of the transitions by destination. */
+EdgeRange fsp::Lts::predecessors(unsigned int state) const
+{
+    if (incoming.empty()) {
+        int n = numStates();
+
+        incoming.offsets.assign(n + 1, 0);
+        incoming.edges.resize(numTransitions());
+        for (int i = 0; i < n; i++) {
+            EdgeRange children = edges(i);
+
+            for (unsigned int j = 0; j < children.size(); j++) {
+                incoming.offsets[children[j].dest + 1]++;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            incoming.offsets[i + 1] += incoming.offsets[i];
+        }
+
+        vector<uint32_t> pos(incoming.offsets.begin(),
+                             incoming.offsets.end() - 1);
+
+        for (int i = 0; i < n; i++) {
+            EdgeRange children = edges(i);
+
+            for (unsigned int j = 0; j < children.size(); j++) {
+                Edge& e = incoming.edges[pos[children[j].dest]++];
+
+                e.action = children[j].action;
+                e.dest = i;
+            }
+        }
+    }
+
+    return EdgeRange(incoming.edges.data() + incoming.offsets[state],
+                     incoming.edges.data() + incoming.offsets[state + 1]);
+}
+
+/* Backward reachability: mark in 'result' the states that can reach
+   one of the 'targets' (e.g. the Error states, or the End state),
+   including the targets themselves. Only the transitions entering the
+   marked states are visited. Return the number of marked states. */
+unsigned int fsp::Lts::coreachable(const vector<bool>& targets,
+                                   vector<bool>& result) const
+{
+    vector<unsigned int> stack;
+    unsigned int count = 0;
+
+    result.assign(numStates(), false);
+    for (int i = 0; i < numStates(); i++) {
+        if (targets[i]) {
+            result[i] = true;
+            stack.push_back(i);
+            count++;
+        }
+    }
+
+    while (!stack.empty()) {
+        EdgeRange preds = predecessors(stack.back());
+
+        stack.pop_back();
+        for (unsigned int j = 0; j < preds.size(); j++) {
+            if (!result[preds[j].dest]) {
+                result[preds[j].dest] = true;
+                stack.push_back(preds[j].dest);
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/* The state shared by the workers of parallel_bfs(). */
+struct BfsShared {
+    const fsp::Lts& lts;
+    const vector<bool>& fresh;
+    const vector<unsigned int>& order;
+
+    /* claim[i] identifies the edge that discovered the state i in
+       the current level: the position of the source state in 'order'
+       (high 32 bits) and the index of the edge (low 32 bits). The
+       smallest one wins, which is the one a sequential BFS would
+       follow first. */
+    vector< atomic<uint64_t> > claim;
+
+    /* The states discovered by each worker in the current level. */
+    vector< vector<unsigned int> > found;
+
+    /* The current level is order[next, last). */
+    atomic<unsigned int> next;
+    unsigned int last;
+
+    static const uint64_t Unclaimed = ~uint64_t(0);
+    static const unsigned int Chunk = 256;
+
+    BfsShared(const fsp::Lts& l, const vector<bool>& f,
+              const vector<unsigned int>& o, unsigned int jobs) :
+                lts(l), fresh(f), order(o), claim(l.numStates()),
+                found(jobs), next(0), last(0) { }
+};
+
+static void bfs_worker(BfsShared *shared, unsigned int id)
+{
+    vector<unsigned int>& found = shared->found[id];
+
+    for (;;) {
+        unsigned int k = shared->next.fetch_add(BfsShared::Chunk);
+        unsigned int stop;
+
+        if (k >= shared->last) {
+            break;
+        }
+        stop = min(k + BfsShared::Chunk, shared->last);
+        for (; k < stop; k++) {
+            EdgeRange children = shared->lts.edges(shared->order[k]);
+
+            for (unsigned int j = 0; j < children.size(); j++) {
+                unsigned int child = children[j].dest;
+                uint64_t key = (uint64_t(k) << 32) | j;
+                uint64_t old;
+
+                if (!shared->fresh[child]) {
+                    continue;
+                }
+                old = shared->claim[child].load(memory_order_relaxed);
+                while (key < old) {
+                    if (shared->claim[child].compare_exchange_weak(old,
+                                                                   key)) {
+                        if (old == BfsShared::Unclaimed) {
+                            found.push_back(child);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Level-synchronous version of the BFS of Lts::deadlockAnalysis(),
+   run by 'jobs' threads. Each level of the BFS is split among the
+   threads, which claim the states of the next level. When the level
+   is complete, its states are sorted by the edge that discovered them
+   first, so that 'order', 'back' and 'actions' are exactly the ones
+   computed by the sequential BFS. */
+static void parallel_bfs(const fsp::Lts& lts, unsigned int jobs,
+                         vector<bool>& fresh, vector<unsigned int>& order,
+                         vector<unsigned int>& back,
+                         vector<unsigned int>& actions)
+{
+    BfsShared shared(lts, fresh, order, jobs);
+    vector<uint64_t> keys;
+    unsigned int first = 0;
+
+    for (unsigned int i = 0; i < shared.claim.size(); i++) {
+        shared.claim[i].store(BfsShared::Unclaimed, memory_order_relaxed);
+    }
+
+    while (first < order.size()) {
+        vector<thread> workers;
+
+        shared.next = first;
+        shared.last = order.size();
+        /* Small levels are not worth the threads. */
+        if (shared.last - first > BfsShared::Chunk) {
+            for (unsigned int i = 1; i < jobs; i++) {
+                workers.push_back(thread(bfs_worker, &shared, i));
+            }
+        }
+        bfs_worker(&shared, 0);
+        for (unsigned int i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+
+        keys.clear();
+        for (unsigned int i = 0; i < jobs; i++) {
+            vector<unsigned int>& found = shared.found[i];
+
+            for (unsigned int j = 0; j < found.size(); j++) {
+                keys.push_back(shared.claim[found[j]].load());
+            }
+            found.clear();
+        }
+        sort(keys.begin(), keys.end());
+
+        /* Append the next level to 'order'. */
+        first = shared.last;
+        for (unsigned int i = 0; i < keys.size(); i++) {
+            unsigned int state = order[keys[i] >> 32];
+            const Edge& e = lts.edges(state)[keys[i] & 0xffffffff];
+
+            fresh[e.dest] = false;
+            back[e.dest] = state;
+            actions[e.dest] = e.action;
+            order.push_back(e.dest);
+        }
+    }
+}
+
+/* Deadlock analysis on a stored LTS. The deadlock and Error states are
+   found with a linear scan, and the BFS only visits the states that can
+   reach one of them: since every state along a shortest trace to a bad
+   state can reach it, the reports and the traces are the same ones of
+   LtsGenerator::deadlockAnalysis(), but the parts of the LTS that
+   cannot lead to a violation are never explored. The BFS of large LTSs
+   is run in parallel (see parallel_bfs()). */
+int fsp::Lts::deadlockAnalysis(stringstream& ss) const
+{
+    int n = numStates();
+    vector<bool> bad(n, false);
+    vector<bool> fresh;  /* Set if the state is relevant and not seen. */
+    vector<unsigned int> back;
+    vector<unsigned int> actions;
+    vector<unsigned int> order;     /* The states in BFS order. */
+    bool found = false;
+    int nd = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (edges(i).empty() && get_type(i) != LtsNode::End) {
+            bad[i] = found = true;
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+    coreachable(bad, fresh);
+    if (!fresh[0]) {
+        return 0;
+    }
+
+    back.resize(n);
+    actions.resize(n);
+    fresh[0] = false;
+    order.push_back(0);
+    if (compose_jobs > 1 && unsigned(n) >= parallel_bfs_states) {
+        parallel_bfs(*this, compose_jobs, fresh, order, back, actions);
+    } else {
+        for (unsigned int k = 0; k < order.size(); k++) {
+            unsigned int state = order[k];
+            EdgeRange children = edges(state);
+
+            for (unsigned int i = 0; i < children.size(); i++) {
+                unsigned int child = children[i].dest;
+
+                if (fresh[child]) {
+                    fresh[child] = false;
+                    back[child] = state;
+                    actions[child] = children[i].action;
+                    order.push_back(child);
+                }
+            }
+        }
+    }
+
+    /* Report the bad states in BFS order. */
+    for (unsigned int k = 0; k < order.size(); k++) {
+        unsigned int state = order[k];
+
+        if (bad[state]) {
+            vector<unsigned int> path;
+            vector<unsigned int> trace;
+
+            for (unsigned int t = state; t; t = back[t]) {
+                trace.push_back(actions[t]);
+                path.push_back(t);
+            }
+            path.push_back(0);
+            reverse(trace.begin(), trace.end());
+            reverse(path.begin(), path.end());
+            report_deadlock(ss, state, path, trace);
+            nd++;
+        }
+    }
+
+    return nd;
+}
+
+/* The state shared by the workers of Lts::parallel_terminal_sets(). */
+struct SccShared {
+    const fsp::Lts& lts;
+    unsigned int jobs;
+
+    /* reach[i] converges to the largest state reachable from i. */
+    vector< atomic<unsigned int> > reach;
+    atomic<bool> changed;
+
+    /* The states i such that reach[i] == i. */
+    vector<unsigned int> roots;
+
+    /* component[i] is the position in 'roots' of the terminal set
+       that contains the state i, or None. */
+    vector<unsigned int> component;
+    vector<fsp::ActionBitset> actions;
+
+    atomic<unsigned int> next;
+
+    static const unsigned int None = ~0U;
+    static const unsigned int Chunk = 256;
+    /* After this number of sweeps the propagation of 'reach' is
+       abandoned, since Tarjan's algorithm would be faster. */
+    static const unsigned int MaxSweeps = 16;
+
+    SccShared(const fsp::Lts& l, unsigned int j) : lts(l), jobs(j),
+                reach(l.numStates()), changed(false), next(0) { }
+};
+
+const unsigned int SccShared::None;
+
+/* One sweep of the propagation of 'reach' along the transitions. The
+   states are visited in decreasing order, so that a value can flow
+   along many forward transitions in the same sweep. Each state is
+   only written by the thread that visits it, and the values only grow,
+   so that the sweeps converge to the same result whatever the
+   interleaving of the threads. */
+static void scc_reach_worker(SccShared *shared, unsigned int id)
+{
+    unsigned int n = shared->lts.numStates();
+    bool changed = false;
+
+    for (;;) {
+        unsigned int k = shared->next.fetch_add(SccShared::Chunk);
+        unsigned int stop;
+
+        if (k >= n) {
+            break;
+        }
+        stop = min(k + SccShared::Chunk, n);
+        for (; k < stop; k++) {
+            unsigned int state = n - 1 - k;
+            EdgeRange children = shared->lts.edges(state);
+            unsigned int old = shared->reach[state].load(memory_order_relaxed);
+            unsigned int r = old;
+
+            for (unsigned int j = 0; j < children.size(); j++) {
+                r = max(r, shared->reach[children[j].dest].load(
+                                                    memory_order_relaxed));
+            }
+            if (r != old) {
+                shared->reach[state].store(r, memory_order_relaxed);
+                changed = true;
+            }
+        }
+    }
+
+    if (changed) {
+        shared->changed = true;
+    }
+}
+
+/* Find the strongly connected component of each root, visiting the
+   states that it can reach without leaving the states with the same
+   'reach'. The component is terminal if the visit never finds a
+   transition that leaves them. Since the visits of different roots
+   touch disjoint sets of states, they need no synchronization. */
+static void scc_component_worker(SccShared *shared, unsigned int id)
+{
+    unsigned int n = shared->lts.numStates();
+    vector<unsigned int> queue;
+
+    for (;;) {
+        unsigned int i = shared->next.fetch_add(1);
+        unsigned int root;
+        bool terminal = true;
+
+        if (i >= shared->roots.size()) {
+            break;
+        }
+        root = shared->roots[i];
+        queue.clear();
+        queue.push_back(root);
+        shared->component[root] = i;
+        for (unsigned int k = 0; k < queue.size() && terminal; k++) {
+            EdgeRange children = shared->lts.edges(queue[k]);
+
+            for (unsigned int j = 0; j < children.size(); j++) {
+                unsigned int child = children[j].dest;
+
+                if (shared->reach[child].load(memory_order_relaxed) !=
+                                                                root) {
+                    terminal = false;
+                    break;
+                }
+                if (shared->component[child] == SccShared::None) {
+                    shared->component[child] = i;
+                    queue.push_back(child);
+                }
+                shared->actions[i].insert(children[j].action);
+            }
+        }
+
+        /* We are not interested in trivial terminal sets (see
+           Lts::terminalSets()). */
+        if (!terminal || queue.size() == n) {
+            for (unsigned int k = 0; k < queue.size(); k++) {
+                shared->component[queue[k]] = SccShared::None;
+            }
+            shared->actions[i].clear();
+        }
+    }
+}
+
+static void scc_run(SccShared& shared,
+                    void (*worker)(SccShared *, unsigned int))
+{
+    vector<thread> workers;
 
-    /* BFS looking for states with no outgoing transitions. We use a BFS
-       instead of a DFS because the former is simpler to implement and
-       because it finds the shortest path to each deadlock state. */
+    shared.next = 0;
+    for (unsigned int i = 1; i < shared.jobs; i++) {
+        workers.push_back(thread(worker, &shared, i));
+    }
+    worker(&shared, 0);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
 
-    /* Initialize a queue that only contains the 0 node. */
-    frontier.push(0);
-    pop_idx = 0;
-    push_idx = 1;
-    seen[0] = true;
-    for (unsigned int i=1; i<n; i++)
-	seen[i] = false;
+/* Parallel version of terminalSets(). The terminal sets are the
+   strongly connected components that cannot be left, so that all the
+   states of a terminal set can reach exactly the states of the set.
+   The largest state reachable from each state is computed in parallel:
+   the largest state of a terminal set is then a root (a state that
+   cannot reach a larger one), and its terminal set is found with a
+   visit from the root. Only the states that are not in a terminal set
+   are then visited by a sequential DFS, which enters the terminal sets
+   in the same order of the DFS of terminalSets(), so that the terminal
+   sets and their traces are the same ones. When there are no terminal
+   sets (e.g. the LTS is strongly connected), the DFS is not needed.
+   Returns false if the propagation does not converge quickly. */
+bool fsp::Lts::parallel_terminal_sets()
+{
+    unsigned int n = numStates();
+    SccShared shared(*this, compose_jobs);
+    unsigned int sweeps = 0;
+    unsigned int left = 0;  /* Terminal sets not entered yet. */
 
-    /* Keep visiting until the queue is empty. */
+    for (unsigned int i = 0; i < n; i++) {
+        shared.reach[i].store(i, memory_order_relaxed);
+    }
     do {
-        unsigned int state;
-	unsigned int i;
+        if (++sweeps > SccShared::MaxSweeps) {
+            return false;
+        }
+        shared.changed = false;
+        scc_run(shared, scc_reach_worker);
+    } while (shared.changed);
 
-	/* Pop a state and examine all its children. */
-	state = frontier.front();
-	for (i=0; i<nodes[state].children.size(); i++) {
-	    int child = nodes[state].children[i].dest;
+    for (unsigned int i = 0; i < n; i++) {
+        if (shared.reach[i].load(memory_order_relaxed) == i) {
+            shared.roots.push_back(i);
+        }
+    }
+    shared.component.assign(n, SccShared::None);
+    shared.actions.resize(shared.roots.size());
+    scc_run(shared, scc_component_worker);
+    for (unsigned int i = 0; i < shared.roots.size(); i++) {
+        if (shared.component[shared.roots[i]] != SccShared::None) {
+            left++;
+        }
+    }
 
-	    if (!seen[child]) {
-		seen[child] = true;
-		back[push_idx] = state;
-		actions[push_idx] = nodes[state].children[i].action;
-                frontier.push(child);
-                push_idx++;
-	    }
-	}
+    vector<bool> entered(n, false);
+    vector<bool> reported(shared.roots.size(), false);
+    vector<unsigned int> path;		/* The DFS stack. */
+    vector<unsigned int> next_child;	/* Parallel to 'path'. */
+    vector<int> trace;			/* The actions along 'path'. */
+    unsigned int state = 0;
+    unsigned int action = 0;
+
+    while (left) {
+        unsigned int c = shared.component[state];
+
+        if (c != SccShared::None) {
+            /* The DFS enters a terminal set: report it with the
+               current trace, without visiting its states. */
+            if (!reported[c]) {
+                TerminalSet& ts = (terminal_sets.push_back(TerminalSet()),
+                                   terminal_sets.back());
+
+                ts.trace = trace;
+                if (!path.empty()) {
+                    ts.trace.push_back(action);
+                }
+                if (symmetry) {
+                    ts.path = path;
+                    ts.path.push_back(state);
+                }
+                ts.actions.swap(shared.actions[c]);
+                reported[c] = true;
+                left--;
+            }
+        } else if (!entered[state]) {
+            entered[state] = true;
+            if (!path.empty()) {
+                trace.push_back(action);
+            }
+            path.push_back(state);
+            next_child.push_back(0);
+        }
 
-	/* No outgoing transitions ==> Deadlock state */
-	if (i == 0 && get_type(state) != LtsNode::End) { 
-	    int t;
-	    int j;
-	    string ed;
-
-	    if (get_type(state) == LtsNode::Normal)
-		ed = "Deadlock";
-	    else
-		ed = "Property violation";
-	    ss << ed << " found for process " << name << ": state "
-			<< state << "\n";
-	    /* Starting from 'state', we follow the backpointers to build the
-	       trace to deadlock (in reverse order). */
-	    t = pop_idx;
-	    j = 0;
-	    while (t) {
-		action_trace[j++] = actions[t];
-		t = back[t];
-	    }
-	    ss << "	Trace to " << ed << ": ";
-	    for (j--; j>=0; j--)
-		ss << ati(action_trace[j], false) << "->";
-	    ss << "\n\n";
-	    nd++;
-	}
-        frontier.pop();
-        pop_idx++;
-    } while (!frontier.empty());
+        /* Look for the next state to enter, unrolling the stack. */
+        while (!path.empty()) {
+            EdgeRange children = edges(path.back());
 
-    delete actions;
-    delete back;
-    delete action_trace;
+            if (next_child.back() < children.size()) {
+                const Edge& e = children[next_child.back()++];
 
-    return nd;
+                state = e.dest;
+                action = e.action;
+                break;
+            }
+            path.pop_back();
+            next_child.pop_back();
+            if (!path.empty()) {
+                trace.pop_back();
+            }
+        }
+        if (path.empty()) {
+            break;
+        }
+    }
+
+    return true;
 }
 
 int fsp::Lts::terminalSets()
 {
-    int n = nodes.size();
+    int n = numStates();
     int na = ActionsTable::getref().size();
     int nts = 0;
 
@@ -622,6 +2808,11 @@ int fsp::Lts::terminalSets()
 	return terminal_sets.size();
     terminal_sets_computed = true;
 
+    if (compose_jobs > 1 && unsigned(n) >= parallel_bfs_states &&
+                                            parallel_terminal_sets()) {
+        return terminal_sets.size();
+    }
+
     /* Data structures for the iterative DFS implementation */
     vector<unsigned int> state_stack(n);  /* Emulated recursion stack */
     vector<unsigned int> action_stack(n); /* Actions stack parallel to the previous */
@@ -685,7 +2876,7 @@ int fsp::Lts::terminalSets()
 	    IFD(cout << state << ".start\n");
 	}
 
-	if (next_child[state] == nodes[state].children.size()) {
+	if (next_child[state] == edges(state).size()) {
 	    /* If there are not more children to examine, we
 	       unroll the recursion stack popping out the node 'state'.
 	       Here we have to finalize the visit, applying the core of the 
@@ -693,8 +2884,8 @@ int fsp::Lts::terminalSets()
 
 	    IFD(cout << state << ".end\n");
 
-	    for (unsigned int i=0; i<nodes[state].children.size(); i++) {
-		int child = nodes[state].children[i].dest; 
+	    for (unsigned int i=0; i<edges(state).size(); i++) {
+		int child = edges(state)[i].dest; 
 		if (tarjan_index[child] > tarjan_index[state]) {
 		    /* If this condition holds, child must be a descendent
 		       of 'state' in the DFS tree. In this case the Tarjan
@@ -744,8 +2935,8 @@ int fsp::Lts::terminalSets()
 		    terminal = true;
 		    for (int j=0; j<nc; j++) {
 			s = tarjan_component_states[j];
-			for (unsigned int i=0; i<nodes[s].children.size(); i++) {
-			    e = nodes[s].children[i];
+			for (unsigned int i=0; i<edges(s).size(); i++) {
+			    e = edges(s)[i];
 			    if (!tarjan_state_in_component[e.dest]) {
 				/* We have a transition that exit the
 				   component */
@@ -789,6 +2980,14 @@ int fsp::Lts::terminalSets()
 			IFD(cout << "    " << ati(action_trace[j], false) << "\n");
 			ts.trace.push_back(action_trace[j]);
 		    }
+		    if (symmetry) {
+			for (t = top; ; t = back[t]) {
+			    ts.path.insert(ts.path.begin(), state_stack[t]);
+			    if (!t) {
+				break;
+			    }
+			}
+		    }
 		    IFD(cout << "Actions in the terminal set: {");
 		    for (j=0; j<nca; j++) {
 			IFD(cout << ati(tarjan_component_actions[j], false) << ", ");
@@ -812,11 +3011,11 @@ clear_flags:
 	} else {
 	    /* If there are still children to examine, let's continue our
 	       DFS visit. */
-	    child = nodes[state].children[next_child[state]].dest;
+	    child = edges(state)[next_child[state]].dest;
 	    if (!entered[child]) {
 		state_stack[++top] = child;
 		action_stack[top] =
-			    nodes[state].children[next_child[state]].action;
+			    edges(state)[next_child[state]].action;
 		back[top] = top - 1;
 		IFD(cout << child << ".push\n");
 	    }
@@ -830,15 +3029,15 @@ clear_flags:
 
 bool fsp::Lts::isDeterministic() const
 {
-    for (unsigned int i=0; i<nodes.size(); i++) {
+    for (int i=0; i<numStates(); i++) {
 	map<int, int> links;
 	pair<map<int, int>::iterator, bool> ret;
 
 	/* For each node, we have to check that the mapping
 	   action --> destination_node is injective (one-to-one).*/
-	for (unsigned int j=0; j<nodes[i].children.size(); j++) {
-	    ret = links.insert(pair<int, int>(nodes[i].children[j].action,
-				    nodes[i].children[j].dest));
+	for (unsigned int j=0; j<edges(i).size(); j++) {
+	    ret = links.insert(pair<int, int>(edges(i)[j].action,
+				    edges(i)[j].dest));
 	    if (!ret.second)
 		return false;
 	}
@@ -856,7 +3055,7 @@ fsp::Symbol *fsp::Lts::clone() const
 
 void fsp::Lts::visit(const struct LtsVisitObject& lvo) const
 {
-    unsigned int n = nodes.size();
+    unsigned int n = numStates();
     queue<unsigned int> frontier;
     vector<bool> seen(n);
     unsigned int visited = 0;
@@ -881,9 +3080,9 @@ void fsp::Lts::visit(const struct LtsVisitObject& lvo) const
 
             state = frontier.front();
             /* Invoke the visit function */
-            lvo.vfp(state, *this, nodes[state], lvo.opaque);
-            for (unsigned int i=0; i<nodes[state].children.size(); i++) {
-                int child = nodes[state].children[i].dest;
+            lvo.vfp(state, *this, edges(state), lvo.opaque);
+            for (unsigned int i=0; i<edges(state).size(); i++) {
+                int child = edges(state)[i].dest;
                 if (!seen[child]) {
                     seen[child] = true;
                     frontier.push(child);
@@ -904,15 +3103,32 @@ fsp::Lts& fsp::Lts::labeling(const SetS& labels)
     if (labels.size() == 1)
 	this->labeling(labels[0]);
     else {
-	fsp::Lts copy(*this);
-
-	this->labeling(labels[0]);
-	for (unsigned int i=1; i<labels.size(); i++) {
-	    fsp::Lts right(copy);
+        /* The relabeled copies have disjoint alphabets (unless two labels
+           generate the same action names), so their product is a pure
+           interleaving: compose all of them at once, without building
+           the intermediate products. */
+        vector< SmartPtr<Lts> > copies;
+        vector<const Lts *> v;
+
+        for (unsigned int i=0; i<labels.size(); i++) {
+            if (i + 1 < labels.size()) {
+                copies.push_back(new fsp::Lts(*this));
+            } else {
+                /* *this is overwritten by the composition, so the last
+                   copy can take its content. */
+                copies.push_back(new fsp::Lts);
+                copies.back()->swap_nodes(*this);
+                copies.back()->alphabet.swap(alphabet);
+            }
+            copies.back()->labeling(labels[i]);
+            v.push_back(copies.back());
+        }
 
-	    right.labeling(labels[i]);
-	    this->compose(right);
-	}
+        if (external_dir.size()) {
+            compose_external(v, false);
+        } else {
+            compose_interleaving(v);
+        }
     }
 
     return *this;
@@ -921,28 +3137,29 @@ fsp::Lts& fsp::Lts::labeling(const SetS& labels)
 fsp::Lts& fsp::Lts::labeling(const string& label)
 {
     ActionsTable& at = ActionsTable::getref();
-    set<unsigned int> new_alphabet;
-    map<int, int> mapping;
+    ActionBitset new_alphabet;
+    vector<uint32_t> mapping(at.size());
 
     terminal_sets_computed = false;
+    /* The action renaming would not be consistent anymore. */
+    symmetry.reset();
+    reduction.reset();
 
     /* Update the actions table, compute a one-to-one [old --> new] mapping
-       and update the alphabet. */
-    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
+       and update the alphabet. Tau is mapped to itself. */
+    for (ActionBitset::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
 	int old_index;
 	int new_index;
 
 	old_index = *it;
 	new_index = at.insert(label + "." + at.lookup(old_index));
 	new_alphabet.insert(new_index);
-	mapping.insert(make_pair(old_index, new_index));
+	mapping[old_index] = new_index;
     }
-    alphabet = new_alphabet;
+    alphabet.swap(new_alphabet);
 
     /* Update the edges actions. */
-    for (unsigned int i=0; i<nodes.size(); i++)
-	for (unsigned int j=0; j<nodes[i].children.size(); j++)
-	    nodes[i].children[j].action = mapping[nodes[i].children[j].action];
+    remap_actions(mapping);
 
     return *this;
 }
@@ -950,14 +3167,18 @@ fsp::Lts& fsp::Lts::labeling(const string& label)
 fsp::Lts& fsp::Lts::sharing(const SetS& labels)
 {
     ActionsTable& at = ActionsTable::getref();
-    set<unsigned int> new_alphabet;
+    ActionBitset new_alphabet;
     map<int, vector<int> > mapping;
 
+    thaw();
     terminal_sets_computed = false;
+    /* The action renaming would not be consistent anymore. */
+    symmetry.reset();
+    reduction.reset();
 
     /* Update the actions table, compute a one-to-many [old --> new] mapping 
        and update the alphabet. */
-    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
+    for (ActionBitset::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
 	int old_index;
 	int new_index;
 	vector<int> new_indexes;
@@ -971,7 +3192,7 @@ fsp::Lts& fsp::Lts::sharing(const SetS& labels)
 	}
 	mapping.insert(make_pair(old_index, new_indexes));
     }
-    alphabet = new_alphabet;
+    alphabet.swap(new_alphabet);
 
     /* Replace the children array of each node. */
     for (unsigned int i=0; i<nodes.size(); i++) {
@@ -996,13 +3217,16 @@ fsp::Lts& fsp::Lts::relabeling(const SetS& newlabels, const string& oldlabel)
 {
     ActionsTable& at = ActionsTable::getref();
     map<int, vector<int> > mapping;
-    set<unsigned int> new_alphabet = alphabet;
+    ActionBitset new_alphabet = alphabet;
 
     terminal_sets_computed = false;
+    /* The action renaming would not be consistent anymore. */
+    symmetry.reset();
+    reduction.reset();
 
     /* Update the actions table, compute a one to many [old --> new]
        mapping and update the alphabet. */
-    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
+    for (ActionBitset::iterator it=alphabet.begin(); it!=alphabet.end(); it++) {
 	int old_index;
 	int new_index;
 	vector<int> new_indexes;
@@ -1026,9 +3250,27 @@ fsp::Lts& fsp::Lts::relabeling(const SetS& newlabels, const string& oldlabel)
 	    mapping.insert(make_pair(old_index, new_indexes));
 	}
     }
-    alphabet = new_alphabet;
+    alphabet.swap(new_alphabet);
+
+    if (newlabels.size() == 1) {
+        /* A one-to-one renaming does not change the structure of the
+           LTS, so just update the edges actions. */
+        vector<uint32_t> actions(at.size());
+
+        for (unsigned int a=0; a<actions.size(); a++) {
+            actions[a] = a;
+        }
+        for (map<int, vector<int> >::iterator it=mapping.begin();
+                                            it!=mapping.end(); it++) {
+            actions[it->first] = it->second[0];
+        }
+        remap_actions(actions);
+
+        return *this;
+    }
 
     /* Replace the children that are to be replaced. */
+    thaw();
     for (unsigned int i=0; i<nodes.size(); i++) {
 	unsigned int original_size = nodes[i].children.size();
 	/* We need 'original_size' since we are going to push_back() in 
@@ -1061,56 +3303,68 @@ fsp::Lts& fsp::Lts::relabeling(const SetS& newlabels, const SetS& oldlabels)
     return *this;
 }
 
-fsp::Lts& fsp::Lts::hiding(const SetS& s, bool interface)
+/* Compute the actions of the alphabet that would be hidden by the
+   hiding operator 's' (or by the interface operator, if 'interface'
+   is true). */
+void fsp::Lts::hiddenActions(const SetS& s, bool interface,
+                             set<unsigned int>& result) const
 {
-    set<unsigned int> new_alphabet;
+    ActionBitset matched;
 
-    terminal_sets_computed = false;
+    for (unsigned int i=0; i<s.size(); i++) {
+        /* The action s[i] can select multiple alphabet elements. */
+        for (ActionBitset::iterator it=alphabet.begin();
+                                            it!=alphabet.end(); it++) {
+            string action = ati(*it, false);
+            pair<string::const_iterator, string::iterator> mm;
+            string cand = s[i];
+
+            /* Prefix match: check if 's[i]' is a prefix of
+               'action'. */
+            mm = mismatch(cand.begin(), cand.end(), action.begin());
+            if (mm.first == cand.end())
+                matched.insert(*it);
+        }
+    }
 
-    /* Update the alphabet. */
     if (interface) {
-	for (unsigned int i=0; i<s.size(); i++) {
-	    /* The action s[i] can select multiple alphabet
-	       elements. */
-	    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end();
-								it++) {
-		string action = ati(*it, false);
-		pair<string::const_iterator, string::iterator> mm;
-                string cand = s[i];
+        ActionBitset unmatched = alphabet;
 
-		/* Prefix match: check if 's[i]' is a prefix of
-		   'action'. */
-		mm = mismatch(cand.begin(), cand.end(), action.begin());
-		if (mm.first == cand.end())
-		    new_alphabet.insert(*it);
-	    }
-	}
+        result = unmatched.subtract(matched).toSet();
     } else {
-	new_alphabet = alphabet;
-	for (unsigned int i=0; i<s.size(); i++) {
-	    /* The action s[i] can hide multiple alphabet elements. */
-	    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end();
-								it++) {
-		string action = ati(*it, false);
-		pair<string::const_iterator, string::iterator> mm;
-                string cand = s[i];
+        result = matched.toSet();
+    }
+}
 
-		/* Prefix match: check if 's[i]' is a prefix of
-		   'action'. */
-		mm = mismatch(cand.begin(), cand.end(), action.begin());
-		if (mm.first == cand.end())
-		    new_alphabet.erase(*it);
-	    }
-	}
+fsp::Lts& fsp::Lts::hiding(const SetS& s, bool interface)
+{
+    set<unsigned int> actions;
+
+    hiddenActions(s, interface, actions);
+
+    return hiding(actions);
+}
+
+/* Hide exactly the actions contained in 'actions'. */
+fsp::Lts& fsp::Lts::hiding(const set<unsigned int>& actions)
+{
+    vector<uint32_t> mapping(ActionsTable::getref().size());
+
+    terminal_sets_computed = false;
+
+    /* Update the alphabet. */
+    for (set<unsigned int>::const_iterator it=actions.begin();
+                                            it!=actions.end(); it++) {
+        alphabet.erase(*it);
     }
-    alphabet = new_alphabet;
 
-    /* Update the edges actions. */
-    for (unsigned int i=0; i<nodes.size(); i++)
-	for (unsigned int j=0; j<nodes[i].children.size(); j++)
-	    if (!alphabet.count(nodes[i].children[j].action))
-		/* We are sure that at->lookup("tau") == 0. */
-		nodes[i].children[j].action = 0;
+    /* Update the edges actions: the actions that are not in the
+       alphabet are mapped to tau (we are sure that
+       at->lookup("tau") == 0). */
+    for (unsigned int a=0; a<mapping.size(); a++) {
+        mapping[a] = alphabet.count(a) ? a : 0;
+    }
+    remap_actions(mapping);
 
     return *this;
 }
@@ -1118,17 +3372,16 @@ fsp::Lts& fsp::Lts::hiding(const SetS& s, bool interface)
 fsp::Lts& fsp::Lts::priority(const SetS& s, bool low)
 {
     int low_int = (low) ? 1 : 0;
-    set<unsigned int> priority_actions;
-    Lts new_lts;
-
-    new_lts.nodes.resize(nodes.size());
+    ActionBitset priority_actions;
+    Lts unconnected;
 
+    thaw();
     terminal_sets_computed = false;
 
     for (unsigned int i=0; i<s.size(); i++) {
 	    /* The action s[i] can select multiple alphabet
 	       elements. */
-	    for (set<unsigned int>::iterator it=alphabet.begin(); it!=alphabet.end();
+	    for (ActionBitset::iterator it=alphabet.begin(); it!=alphabet.end();
 								it++) {
 		string action = ati(*it, false);
 		pair<string::const_iterator, string::iterator> mm;
@@ -1142,26 +3395,24 @@ fsp::Lts& fsp::Lts::priority(const SetS& s, bool low)
 	    }
     }
 
+    /* Remove the low priority transitions in place. A state keeps all
+       its transitions if none of them has high priority. */
     for (unsigned int i=0; i<nodes.size(); i++) {
-	vector<Edge> new_children;
-	bool found = false;
+        vector<Edge>& children = nodes[i].children;
+        unsigned int m = 0;
 
-	for (unsigned int j=0; j<nodes[i].children.size(); j++) 
-	    if (priority_actions.count(nodes[i].children[j].action)
-							    ^ low_int) {
-		new_children.push_back(nodes[i].children[j]);
-		found = true;
+	for (unsigned int j=0; j<children.size(); j++)
+	    if (priority_actions.count(children[j].action) ^ low_int) {
+		children[m++] = children[j];
 	    }
-	if (found) {
-	    new_lts.nodes[i].children = new_children;
-            new_lts.set_type(i, get_type(i));
-            new_lts.set_priv(i, get_priv(i));
-	} else {
-            copy_node_out(new_lts, i, i);
-        }
+	if (m) {
+	    children.resize(m);
+	}
     }
 
-    reduce(new_lts);
+    /* Move the graph out of *this, so that reduce() can rebuild it. */
+    unconnected.swap_nodes(*this);
+    reduce(unconnected);
 
     return *this;
 }
@@ -1175,6 +3426,7 @@ fsp::Lts& fsp::Lts::property()
     if (!isDeterministic())
 	return *this;
 
+    thaw();
     terminal_sets_computed = false;
 
     /* Look for the ERROR state. If there is no ERROR state, create one. */
@@ -1201,10 +3453,11 @@ fsp::Lts& fsp::Lts::property()
        For such actions, create an outgoing edge to the ERROR state. */
     for (unsigned int i=0; i<nodes.size(); i++)
 	if (i != e.dest) {
-	    set<unsigned int> to_error = alphabet;
+	    ActionBitset to_error = alphabet;
+
 	    for (unsigned int j=0; j<nodes[i].children.size(); j++)
 		to_error.erase(nodes[i].children[j].action);
-	    for (set<unsigned int>::iterator it=to_error.begin();
+	    for (ActionBitset::iterator it=to_error.begin();
 					it!=to_error.end(); it++) {
 		e.action = *it;
 		nodes[i].children.push_back(e);
@@ -1214,49 +3467,232 @@ fsp::Lts& fsp::Lts::property()
     return *this;
 }
 
+/* Return true if the progress property 'pr' can be checked on this
+   symmetry reduced LTS, since it is invariant under the symmetry. */
+bool fsp::Lts::symmetric_progress(const ProgressS& pr) const
+{
+    return symmetry->invariant(pr.set.actions) &&
+                (!pr.conditional || symmetry->invariant(pr.condition.actions));
+}
+
+/* Return true if progress() needs the LTS without reduction to check
+   some of the 'checks'. */
+bool fsp::Lts::progressNeedsUnreduced(
+                        const vector<ProgressCheck>& checks) const
+{
+    if (!reduction || checks.empty()) {
+        return false;
+    }
+    if (!symmetry) {
+        return true;
+    }
+    for (unsigned int k = 0; k < checks.size(); k++) {
+        if (!symmetric_progress(*checks[k].second)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Return the LTS without reduction, computing it the first time it
+   is needed. */
+fsp::Lts *fsp::Lts::expanded_lts()
+{
+    if (!reduction->expanded) {
+        vector< SmartPtr<Lts> > ltsv;
+        Lts *expanded;
+        set<unsigned int> hidden;
+
+        for (unsigned int k = 0; k < reduction->components.size(); k++) {
+            ltsv.push_back(new Lts(*reduction->components[k]));
+        }
+        expanded = new Lts(ltsv);
+        for (unsigned int k = 0; k < reduction->components.size(); k++) {
+            const ActionBitset& a = reduction->components[k]->alphabet;
+
+            for (ActionBitset::const_iterator it = a.begin();
+                                                it != a.end(); it++) {
+                if (!alphabet.count(*it)) {
+                    hidden.insert(*it);
+                }
+            }
+        }
+        expanded->hiding(hidden);
+        expanded->name = name;
+        reduction->expanded = expanded;
+    }
+
+    return reduction->expanded;
+}
+
+/* Return the LTS without reduction: *this, unless it has been composed
+   with a reduction (see Reduction). The operators, the output file and
+   the analyses that are not preserved by the reduction use it. */
+fsp::Lts *fsp::Lts::unreduced()
+{
+    return reduction ? expanded_lts() : this;
+}
+
+/* Output the trace to the terminal set 'ts' and its actions, as
+   reported by a progress violation. */
+void fsp::Lts::describe_terminal_set(const TerminalSet& ts,
+                                     string& result) const
+{
+    vector<unsigned int> trace(ts.trace.begin(), ts.trace.end());
+    ActionBitset actions = ts.actions;
+    stringstream ss;
+
+    if (symmetry) {
+	/* Report the trace and the terminal set of the LTS without
+	   symmetry reduction. */
+	vector<uint32_t> last;
+
+	symmetric_trace(ts.path, trace, last);
+	symmetric_actions(last, actions);
+    }
+    ss << "	Trace to violation: ";
+    for (unsigned int j=0; j<trace.size(); j++)
+	ss << ati(trace[j], false) << "-> ";
+    ss << "\n";
+    ss << "	Actions in terminal set: {";
+    for (ActionBitset::iterator it=actions.begin();
+	    it!=actions.end(); it++)
+	ss << ati(*it, false) << ", ";
+    ss << "}\n\n";
+    result = ss.str();
+}
+
 int fsp::Lts::progress(const string& progress_name, const ProgressS& pr,
 					    stringstream& ss)
 {
-    int npv = 0;    /* Number of progress violations. */
+    vector<ProgressCheck> checks(1, ProgressCheck(progress_name, &pr));
+    vector<string> reports;
+    vector<int> violations;
+
+    progress(checks, reports, violations);
+    ss << reports[0];
+
+    return violations[0];
+}
+
+/* Check all the progress properties 'checks' at once. The report of
+   each property is stored into the corresponding element of 'reports',
+   and its number of violations into the one of 'violations'. The
+   terminal sets are computed only once, and the properties are
+   restricted to the actions that appear in some terminal set, so that
+   a property that cannot match any terminal set is decided without
+   looking at them. The description of a terminal set is formatted
+   once, even if it violates many properties. */
+void fsp::Lts::progress(const vector<ProgressCheck>& checks,
+                        vector<string>& reports, vector<int>& violations)
+{
+    vector<ProgressCheck> unreduced;
+    vector<unsigned int> unreduced_idx;
+    ActionBitset terminal_actions;  /* Union of the terminal sets. */
+    vector<string> descriptions;
+    unsigned int nc = 0;
+
+    reports.assign(checks.size(), string());
+    violations.assign(checks.size(), 0);
+    if (checks.empty()) {
+        return;
+    }
+
+    if (reduction && !symmetry) {
+        /* Partial order reduction does not preserve progress. */
+        expanded_lts()->progress(checks, reports, violations);
+        return;
+    }
+
+    if (symmetry) {
+        /* The reduced LTS can only be used if the property is symmetric
+           too: otherwise the property is checked against the LTS
+           without reduction. */
+        for (unsigned int k = 0; k < checks.size(); k++) {
+            if (!symmetric_progress(*checks[k].second)) {
+                unreduced.push_back(checks[k]);
+                unreduced_idx.push_back(k);
+            }
+        }
+        if (unreduced.size()) {
+            vector<string> r;
+            vector<int> v;
+
+            expanded_lts()->progress(unreduced, r, v);
+            for (unsigned int j = 0; j < unreduced.size(); j++) {
+                reports[unreduced_idx[j]].swap(r[j]);
+                violations[unreduced_idx[j]] = v[j];
+            }
+            if (unreduced.size() == checks.size()) {
+                return;
+            }
+        }
+    }
 
     terminalSets();
 
     for (unsigned int i=0; i<terminal_sets.size(); i++) {
-	TerminalSet& ts = terminal_sets[i];
-	bool violation;
+        terminal_actions.unite(terminal_sets[i].actions);
+    }
+    descriptions.resize(terminal_sets.size());
+
+    for (unsigned int k = 0; k < checks.size(); k++) {
+        const ProgressS& pr = *checks[k].second;
+        ActionBitset progress_set = pr.set.actions;
+        ActionBitset condition;
+        stringstream ss;
 
+        if (nc < unreduced_idx.size() && unreduced_idx[nc] == k) {
+            nc++;
+            continue;
+        }
+
+        progress_set.intersect(terminal_actions);
         if (pr.conditional) {
-            /* There is a conditional progress violation for the progress 'pr'
-               if the intersection between 'pr.condition' and the terminal set
-              'ts' is not empty and the intersection between 'pr.set' and 'ts'
-              is empty. */
-            violation = intersection_exists(pr.condition.actions, ts.actions) &&
-                        !intersection_exists(pr.set.actions, ts.actions);
-        } else {
-            /* There is an uncoditional progress violation for the progress 'pr'
-               if the intersection between 'pr.set' and the terminal set 'ts'
-               is empty. */
-            violation = !intersection_exists(pr.set.actions, ts.actions);
+            condition = pr.condition.actions;
+            condition.intersect(terminal_actions);
+            if (condition.empty()) {
+                /* The condition never holds. */
+                continue;
+            }
         }
 
-	if (violation) {
+        for (unsigned int i=0; i<terminal_sets.size(); i++) {
+            const TerminalSet& ts = terminal_sets[i];
+
+            /* There is an uncoditional progress violation for the
+               progress 'pr' if the intersection between 'pr.set' and
+               the terminal set 'ts' is empty. A conditional progress
+               violation also needs a non-empty intersection between
+               'pr.condition' and 'ts'. */
+            if ((pr.conditional && !condition.intersects(ts.actions)) ||
+                    progress_set.intersects(ts.actions)) {
+                continue;
+            }
+
+            if (descriptions[i].empty()) {
+                describe_terminal_set(ts, descriptions[i]);
+            }
 	    ss << "Progress violation detected for process " << name
-		<< " and progress property " << progress_name << ":\n";
-	    ss << "	Trace to violation: ";
-	    for (unsigned int j=0; j<ts.trace.size(); j++)
-		ss << ati(ts.trace[j], false) << "-> ";
-	    ss << "\n";
-	    ss << "	Actions in terminal set: {";
-	    for (set<unsigned int>::iterator it=ts.actions.begin();
-		    it!=ts.actions.end(); it++)
-		ss << ati(*it, false) << ", ";
-	    ss << "}\n\n";
-
-            npv++;
-	}
+		<< " and progress property " << checks[k].first << ":\n";
+            ss << descriptions[i];
+            violations[k]++;
+        }
+        reports[k] = ss.str();
+    }
+}
+
+/* A linear temporal logic property is not symmetric in general, and
+   it is not preserved by partial order reduction, so it is checked
+   against the LTS without reduction. */
+int fsp::Lts::ltlAnalysis(const LtlProperty& property, stringstream& ss)
+{
+    if (reduction) {
+        return expanded_lts()->ltlAnalysis(property, ss);
     }
 
-    return npv;
+    return LtsGenerator::ltlAnalysis(property, ss);
 }
 
 static void print_compression_table(const list< vector< set<string> > >&
@@ -1555,7 +3991,7 @@ void fsp::Lts::graphvizOutput(const char *filename, bool compress) const
     fout << "digraph G {\n";
     fout << "rankdir = LR;\n";
     //fout << "ratio = 1.0;\n";
-    for (unsigned int i=0; i<nodes.size(); i++) {
+    for (int i=0; i<numStates(); i++) {
 	switch (get_type(i)) {
 	    case LtsNode::Normal:
 		fout << i
@@ -1575,12 +4011,13 @@ void fsp::Lts::graphvizOutput(const char *filename, bool compress) const
 	}
     }
 
-    for (unsigned int i = 0; i<nodes.size(); i++) {
+    for (int i = 0; i<numStates(); i++) {
+        EdgeRange children = edges(i);
         set<unsigned int> destinations;
 
         /* Collect all the neighbours of this state. */
-        for (unsigned int j = 0; j < nodes[i].children.size(); j++) {
-            destinations.insert(nodes[i].children[j].dest);
+        for (unsigned int j = 0; j < children.size(); j++) {
+            destinations.insert(children[j].dest);
         }
 
         for (set<unsigned int>::iterator it = destinations.begin();
@@ -1589,9 +4026,9 @@ void fsp::Lts::graphvizOutput(const char *filename, bool compress) const
             set<string> labels;
 
             /* Collect the actions for the neighbour '*it'. */
-            for (unsigned int j = 0; j < nodes[i].children.size(); j++) {
-                if (nodes[i].children[j].dest == *it) {
-                    actions.insert(nodes[i].children[j].action);
+            for (unsigned int j = 0; j < children.size(); j++) {
+                if (children[j].dest == *it) {
+                    actions.insert(children[j].action);
                 }
             }
 
@@ -1611,7 +4048,7 @@ void fsp::Lts::graphvizOutput(const char *filename, bool compress) const
     fout.close();
 }
 
-void fsp::Lts::print_trace(const vector<int>& trace, stringstream& ss) const
+static void print_trace(const vector<int>& trace, stringstream& ss)
 {
     int size = trace.size();
 
@@ -1626,13 +4063,13 @@ void fsp::Lts::print_trace(const vector<int>& trace, stringstream& ss) const
     ss << ati(trace[size-1], false) << "\n";
 }
 
-void fsp::Lts::simulate(Shell& sh, const ActionSetS *menu) const
+void fsp::LtsGenerator::simulate(Shell& sh, const ActionSetS *menu) const
 {
     stringstream ss;
     int state = 0;
     vector<int> trace;
 
-    if (!nodes.size()) {
+    if (!discovered()) {
         ss << "    Cannot simulate an empty LTS.\n";
         sh.putsstream(ss, true);
         return;
@@ -1651,8 +4088,10 @@ void fsp::Lts::simulate(Shell& sh, const ActionSetS *menu) const
 
 	/* Build the elegible actions as a set in order to remove 
 	   duplicates. */
-	for (i=0; i<nodes[state].children.size(); i++) {
-	    elegible_actions_set.insert(nodes[state].children[i].action);
+        EdgeRange children = successors(state);
+
+	for (i=0; i<children.size(); i++) {
+	    elegible_actions_set.insert(children[i].action);
 	}
 
 	/* Build two vector<int>'s from the set<unsigned int>. */
@@ -1709,9 +4148,11 @@ choose:
             a = elegible_actions[idx];
         }
 
-        for (i=0; i<nodes[state].children.size(); i++) {
-            if (nodes[state].children[i].action == a)
-                dest.push_back(nodes[state].children[i].dest);
+        EdgeRange edges = successors(state);
+
+        for (i=0; i<edges.size(); i++) {
+            if (edges[i].action == a)
+                dest.push_back(edges[i].dest);
         }
         trace.push_back(a);
 
@@ -1728,12 +4169,12 @@ struct OutputData {
     fstream *fsptr;
 };
 
-static void basicVisitFunction(int state, const fsp::Lts& lts, const struct LtsNode& node,
+static void basicVisitFunction(int state, const fsp::Lts& lts, const EdgeRange& node,
 				void *opaque)
 {
     OutputData *bvd = static_cast<OutputData *>(opaque);
     fstream *fsptr = bvd->fsptr;
-    int size = node.children.size();
+    int size = node.size();
 
     *fsptr << ",\nS" << state << " = ";
     if (!size) {
@@ -1752,11 +4193,11 @@ static void basicVisitFunction(int state, const fsp::Lts& lts, const struct LtsN
 	*fsptr << "(";
 
 	for (int i=0; i<size-1; i++) {
-	    *fsptr << ati(node.children[i].action, true)
-		<< " -> S" << node.children[i].dest << "\n  | ";
+	    *fsptr << ati(node[i].action, true)
+		<< " -> S" << node[i].dest << "\n  | ";
 	}
-	*fsptr << ati(node.children[size-1].action, true)
-	    << " -> S" << node.children[size-1].dest << ")";
+	*fsptr << ati(node[size-1].action, true)
+	    << " -> S" << node[size-1].dest << ")";
     }
 }
 
@@ -1803,7 +4244,7 @@ void fsp::Lts::reachable_actions_set(unsigned int state,
 
     do {
         unsigned int st = frontier.front();
-        const vector<Edge>& children = nodes[st].children;
+        EdgeRange children = edges(st);
         bool is_tau_deadlock = tau_dead_set.count(st);
 
         for (unsigned int j = 0; j < children.size(); j++) {
@@ -1846,7 +4287,7 @@ bool fsp::Lts::in_tau_deadlock(unsigned int state) const
 
     do {
         unsigned int st = frontier.front();
-        const vector<Edge>& children = nodes[st].children;
+        EdgeRange children = edges(st);
 
         for (unsigned int j = 0; j < children.size(); j++) {
             if (children[j].action == 0) {
@@ -1923,7 +4364,7 @@ void fsp::Lts::reachable_partitions_set(unsigned int state,
 
     do {
         unsigned int st = frontier.front();
-        const vector<Edge>& children = nodes[st].children;
+        EdgeRange children = edges(st);
         bool is_tau_deadlock = tau_dead_set.count(st);
 
         for (unsigned int j = 0; j < children.size(); j++) {
@@ -2034,10 +4475,13 @@ void fsp::Lts::minimize(stringstream& ss)
     unsigned int *partitions_map = NULL;
     set<unsigned int> tau_dead_set;
 
+    thaw();
     if (!nodes.size()) {
         return;
     }
 
+    symmetry.reset();
+    reduction.reset();
     partitions_map = new unsigned int[nodes.size()];
 
     /* First step: Partition according to the outgoing alphabets.
@@ -2234,9 +4678,12 @@ void fsp::Lts::collapse_tau_chains(stringstream &ss)
     unsigned int *ingoing;
 
     queue<unsigned int> frontier;
-    vector<bool> seen(nodes.size());
+    vector<bool> seen;
     map<unsigned int, unsigned int> collapse_map;
 
+    thaw();
+    seen.resize(nodes.size());
+
     /* Precompute the number of ingoing transitions for each node. */
     ingoing = new unsigned int[nodes.size()];
     for (unsigned int i = 0; i < nodes.size(); i++) {
@@ -2415,6 +4862,7 @@ void fsp::Lts::traces(stringstream& ss)
     set<CEdge> marked;
     vector<unsigned int> trace;
 
+    thaw();
     __traces(ss, marked, trace, 0);
 }
 
@@ -2432,12 +4880,14 @@ void LtsNode::offset(int offset)
 */
 unsigned int fsp::Lts::append(const fsp::Lts& lts, unsigned int first)
 {
-    unsigned int offset = nodes.size() - first;
+    unsigned int offset;
 
+    thaw();
+    offset = nodes.size() - first;
     assert(first < nodes.size());
 
     /* Append the new nodes in this->nodes, offsetting the destinations. */
-    for (unsigned int i=first; i<lts.nodes.size(); i++) {
+    for (int i=first; i<lts.numStates(); i++) {
         nodes.push_back(LtsNode());
         copy_node_in(nodes.size() - 1, lts, i);
         nodes.back().offset(offset);
@@ -2448,6 +4898,33 @@ unsigned int fsp::Lts::append(const fsp::Lts& lts, unsigned int first)
     return offset;
 }
 
+/* Add a new state of type 'type', with no transitions, and return
+   its index. Together with add_edge(), this allows to build a process
+   in place, without translating each part into a separate LTS and then
+   appending it. */
+unsigned int fsp::Lts::add_state(unsigned int type)
+{
+    thaw();
+    nodes.push_back(LtsNode());
+    set_type(nodes.size() - 1, type);
+
+    return nodes.size() - 1;
+}
+
+/* Add a transition from 'state' to 'dest' labeled with 'label'. */
+void fsp::Lts::add_edge(unsigned int state, const string& label,
+                        unsigned int dest)
+{
+    Edge e;
+
+    thaw();
+    assert(state < nodes.size() && dest < nodes.size());
+    e.dest = dest;
+    e.action = ActionsTable::getref().insert(label);
+    alphabet.insert(e.action);
+    nodes[state].children.push_back(e);
+}
+
 /* This function extends *this appending 'lts' to the start node
    (nodes[0]). The two Lts object are connected by an edge labeled
    with 'label'.
@@ -2473,9 +4950,12 @@ fsp::Lts& fsp::Lts::zerocat(const fsp::Lts& lts, const string& label)
 void fsp::Lts::removeType(unsigned int type, unsigned int zero_idx,
                          bool call_reduce)
 {
-    vector<unsigned int> remap(nodes.size());
+    vector<unsigned int> remap;
     unsigned int cnt = 0;
 
+    thaw();
+    remap.resize(nodes.size());
+
     /* Create the mapping from the original state names (indexes) to the names after
        compacting. */
     if (zero_idx != ~0U) {
@@ -2494,31 +4974,37 @@ void fsp::Lts::removeType(unsigned int type, unsigned int zero_idx,
 
     new_lts.nodes.resize(cnt);
 
-    /* Regenerate this->nodes using the mapping. */
+    /* Regenerate this->nodes using the mapping. The transitions are
+       moved into 'new_lts' and filtered in place, rather than copied. */
     for (unsigned int i=0; i<nodes.size(); i++) {
-        const LtsNode& n = nodes[i];
         unsigned k = remap[i];
 
         if (k != ~0U) {
+            vector<Edge>& children = new_lts.nodes[k].children;
+            unsigned int m = 0;
+
             /* Rule out incomplete nodes. */
             new_lts.set_type(k, get_type(i));
             new_lts.set_priv(k, get_priv(i));
-            for (unsigned int j=0; j<n.children.size(); j++) {
-                Edge e = n.children[j];
+            children.swap(nodes[i].children);
+            for (unsigned int j=0; j<children.size(); j++) {
+                Edge e = children[j];
 
                 if (remap[e.dest] != ~0U) {
                     /* Rule out transitions towards incomplete nodes. */
                     e.dest = remap[e.dest];
-                    new_lts.nodes[k].children.push_back(e);
+                    children[m++] = e;
                 }
             }
+            children.resize(m);
         }
     }
 
     if (call_reduce) {
         reduce(new_lts);
     } else {
-        copy_nodes_in(new_lts);
+        nodes.swap(new_lts.nodes);
+        infos.swap(new_lts.infos);
     }
 }
 
@@ -2530,10 +5016,21 @@ void fsp::Lts::removeType(unsigned int type, unsigned int zero_idx,
 */
 fsp::Lts& fsp::Lts::incompcat(const vector< fsp::SmartPtr<fsp::Lts> >& ltsv)
 {
-    unsigned int num_nodes = nodes.size();
+    unsigned int num_nodes;
+    unsigned int total;
     vector<unsigned int> offsets(ltsv.size());
     unsigned int priv;
 
+    thaw();
+    num_nodes = nodes.size();
+
+    /* Make room for all the LTSs that may be appended. */
+    total = num_nodes;
+    for (unsigned int i=0; i<ltsv.size(); i++) {
+        total += ltsv[i]->numStates();
+    }
+    nodes.reserve(total);
+
     /* Prepare the 'offset' array, parallel to 'ltsv'. The entry 'offset[k]'
        contains the state index of *this corresponding to 'ltsv[k][0]'
        (after ltsv[k] has been appended to *this, obviously).*/
@@ -2577,10 +5074,11 @@ fsp::Lts& fsp::Lts::incompcat(const vector< fsp::SmartPtr<fsp::Lts> >& ltsv)
 fsp::Lts& fsp::Lts::zeromerge(const fsp::Lts& lts)
 {
     unsigned int offset = append(lts, 1);
+    EdgeRange children = lts.edges(0);
 
     /* Make the connections. */
-    for (unsigned int j=0; j<lts.nodes[0].children.size(); j++) {
-        Edge e = lts.nodes[0].children[j];
+    for (unsigned int j=0; j<children.size(); j++) {
+        Edge e = children[j];
 
         e.dest += offset;
         nodes[0].children.push_back(e);
@@ -2596,6 +5094,7 @@ bool fsp::Lts::endcat(const fsp::Lts& lts)
     unsigned int x;
 
     assert(lts.numStates() > 0);
+    thaw();
 
     /* Find the End node (well, the first that we run into, but this
        method should be invoked after the mergeEndNodes() method). */
@@ -2636,6 +5135,8 @@ fsp::Lts& fsp::Lts::mergeEndNodes()
 {
     unsigned int x;
 
+    thaw();
+
     /* Select the first End node that we run into. */
     for (x=0; x<nodes.size(); x++) {
         if (get_type(x) == LtsNode::End) {
@@ -2691,6 +5192,7 @@ static void extend_infos(vector<LtsNodeInfo>& infos, unsigned int request,
 
 void fsp::Lts::set_type(unsigned int state, unsigned int type)
 {
+    thaw();
     assert(state < nodes.size());
 
     extend_infos(infos, state, nodes.size());
@@ -2705,7 +5207,7 @@ void fsp::Lts::set_type(unsigned int state, unsigned int type)
 
 unsigned int fsp::Lts::get_type(unsigned int state) const
 {
-    assert(state < nodes.size());
+    assert(int(state) < numStates());
 
     if (state >= infos.size()) {
         if (state == end) {
@@ -2723,6 +5225,7 @@ unsigned int fsp::Lts::get_type(unsigned int state) const
 /* Set the 'priv' field of *this[state] to 'val'. */
 void fsp::Lts::set_priv(unsigned int state, unsigned int val)
 {
+    thaw();
     assert(state < nodes.size());
 
     extend_infos(infos, state, nodes.size());
@@ -2733,7 +5236,7 @@ void fsp::Lts::set_priv(unsigned int state, unsigned int val)
 /* Get the 'priv' field of *this[state]. */
 unsigned int fsp::Lts::get_priv(unsigned int state) const
 {
-    assert(state < nodes.size());
+    assert(int(state) < numStates());
 
     if (state >= infos.size()) {
         return LtsNode::NoPriv;
@@ -2757,6 +5260,7 @@ unsigned int fsp::Lts::resolve()
     unsigned int priv;
     unsigned int zero_idx = ~0U;
 
+    thaw();
     for (unsigned int i=0; i<nodes.size(); i++) {
         unsigned int sz = nodes[i].children.size();
 
@@ -2816,7 +5320,7 @@ unsigned int fsp::Lts::resolve()
 */
 void fsp::Lts::check_privs(set<unsigned int>& privs)
 {
-    for (unsigned int i=0; i<nodes.size(); i++) {
+    for (int i=0; i<numStates(); i++) {
         unsigned int priv = get_priv(i);
 
         if (privs.count(priv)) {
@@ -2830,6 +5334,7 @@ void fsp::Lts::check_privs(set<unsigned int>& privs)
 */
 void fsp::Lts::replace_priv(unsigned int new_priv, unsigned int old_priv)
 {
+    thaw();
     for (unsigned int i=0; i<nodes.size(); i++) {
         if (get_priv(i) == old_priv) {
             set_priv(i, new_priv);
@@ -2837,10 +5342,123 @@ void fsp::Lts::replace_priv(unsigned int new_priv, unsigned int old_priv)
     }
 }
 
-vector<Edge> fsp::Lts::get_children(unsigned int state) const
+EdgeRange fsp::Lts::get_children(unsigned int state) const
 {
-    assert(state >= 0 && state < nodes.size());
+    assert(int(state) < numStates());
 
-    return nodes[state].children;
+    return edges(state);
 }
 
+
+/* ====================== Parallel process analysis ==================== */
+struct AnalysisShared {
+    const vector<fsp::Lts *>& ltsv;
+    bool deadlock;
+    bool graphviz;
+    const vector<fsp::ProgressCheck>& checks;
+    vector<fsp::AnalysisReport>& reports;
+
+    /* The processes analyzed by the same worker, in order. */
+    vector< vector<unsigned int> > groups;
+
+    /* The next group to be analyzed. */
+    atomic<unsigned int> next;
+
+    AnalysisShared(const vector<fsp::Lts *>& v, bool d, bool g,
+                   const vector<fsp::ProgressCheck>& c,
+                   vector<fsp::AnalysisReport>& r) : ltsv(v), deadlock(d),
+                                                     graphviz(g), checks(c),
+                                                     reports(r), next(0) { }
+};
+
+static void analysis_worker(AnalysisShared *shared)
+{
+    for (;;) {
+        unsigned int g = shared->next++;
+
+        if (g >= shared->groups.size()) {
+            break;
+        }
+
+        for (unsigned int j = 0; j < shared->groups[g].size(); j++) {
+            unsigned int i = shared->groups[g][j];
+            fsp::Lts& lts = *shared->ltsv[i];
+            fsp::AnalysisReport& report = shared->reports[i];
+
+            if (shared->deadlock) {
+                stringstream ss;
+
+                report.deadlocks = lts.deadlockAnalysis(ss);
+                report.deadlock = ss.str();
+            }
+
+            if (shared->graphviz) {
+                lts.unreduced()->graphvizOutput((lts.name + ".gv").c_str(),
+                                                true);
+            }
+
+            lts.progress(shared->checks, report.progress,
+                         report.violations);
+        }
+    }
+}
+
+/* Run the deadlock analysis (if 'deadlock' is true), the GraphViz
+   output (if 'graphviz' is true) and the progress checks 'checks' on
+   each process in 'ltsv', using 'jobs' threads. The report of each
+   process is stored into the corresponding element of 'reports', so
+   that the caller can output the reports in a deterministic order.
+   The analyses may modify an LTS (e.g. they compute its terminal
+   sets), so the processes that share some data (e.g. the same LTS or
+   the same reduction) are analyzed by the same thread.
+   The analyses of a single process may use Lts::compose_jobs threads
+   themselves (see parallel_bfs() and parallel_terminal_sets()), so this
+   budget is split among the workers while they run.
+   The LTSs without reduction that the analyses need are computed here,
+   before starting the workers, since computing them is not thread
+   safe (e.g. it updates the reference counters of the components). */
+void fsp::analyze_processes(const vector<Lts *>& ltsv, bool deadlock,
+                            bool graphviz,
+                            const vector<ProgressCheck>& checks,
+                            unsigned int jobs,
+                            vector<AnalysisReport>& reports)
+{
+    AnalysisShared shared(ltsv, deadlock, graphviz, checks, reports);
+    map<const void *, unsigned int> group;
+    vector<thread> workers;
+    unsigned int inner_jobs = Lts::compose_jobs;
+
+    reports.assign(ltsv.size(), AnalysisReport());
+
+    for (unsigned int i = 0; i < ltsv.size(); i++) {
+        const void *key = ltsv[i]->reduction ?
+                            static_cast<const void *>(ltsv[i]->reduction.get()) :
+                            static_cast<const void *>(ltsv[i]);
+        map<const void *, unsigned int>::iterator it = group.find(key);
+
+        if (it == group.end()) {
+            it = group.insert(make_pair(key, shared.groups.size())).first;
+            shared.groups.push_back(vector<unsigned int>());
+        }
+        shared.groups[it->second].push_back(i);
+    }
+
+    for (unsigned int i = 0; i < ltsv.size(); i++) {
+        if (ltsv[i]->reduction && (graphviz ||
+                    ltsv[i]->progressNeedsUnreduced(checks))) {
+            ltsv[i]->unreduced();
+        }
+    }
+
+    jobs = max(min(jobs, static_cast<unsigned int>(shared.groups.size())),
+               1U);
+    Lts::compose_jobs = max(inner_jobs / jobs, 1U);
+    for (unsigned int i = 1; i < jobs; i++) {
+        workers.push_back(thread(analysis_worker, &shared));
+    }
+    analysis_worker(&shared);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    Lts::compose_jobs = inner_jobs;
+}
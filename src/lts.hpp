@@ -22,12 +22,16 @@
 #define __LTS__H__
 
 #include "symbols_table.hpp"
+#include "state_table.hpp"
+#include "symmetry.hpp"
 #include "location.hh"
 
 #include <iostream>
 #include <vector>
 #include <list>
+#include <memory>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <set>
 #include <assert.h>
@@ -38,7 +42,11 @@ using namespace std;
 
 struct TerminalSet {
     vector<int> trace;
-    set<unsigned int> actions;
+    fsp::ActionBitset actions;
+
+    /* The states visited by 'trace' (only used with symmetry
+       reduction). */
+    vector<unsigned int> path;
 };
 
 /* An LTS edge. */
@@ -47,6 +55,23 @@ struct Edge {
     uint32_t action;
 };
 
+/* A read-only view of the outgoing edges of a state, which are stored
+   contiguously (either in an LtsNode or in a FrozenGraph). */
+class EdgeRange {
+    const Edge *first;
+    const Edge *last;
+
+  public:
+    EdgeRange(const Edge *f, const Edge *l) : first(f), last(l) { }
+    EdgeRange(const vector<Edge>& v) : first(v.data()),
+                                       last(v.data() + v.size()) { }
+    unsigned int size() const { return last - first; }
+    bool empty() const { return first == last; }
+    const Edge& operator[](unsigned int i) const { return first[i]; }
+    const Edge *begin() const { return first; }
+    const Edge *end() const { return last; }
+};
+
 /* A complete LTS edge (includes source node).
    Only used internally. */
 class CEdge {
@@ -83,6 +108,41 @@ struct LtsNode {
     void offset(int offset);
 };
 
+/* An action-indexed view of the outgoing edges of the nodes of an LTS,
+   built before composition. For each node, the edges are sorted by
+   action (edges with the same action keep their relative order), so
+   that all the edges of a node labeled with a given action can be
+   found with a binary search, rather than scanning all the edges.
+   The alphabet of the LTS is also copied here, so that the index is
+   self-contained. */
+struct ActionIndex {
+    vector<uint32_t> offsets;   /* Edges of node i are in [offsets[i],
+                                   offsets[i+1]). */
+    vector<Edge> edges;
+    fsp::ActionBitset alphabet;
+
+    bool inAlphabet(uint32_t action) const {
+        return alphabet.count(action);
+    }
+    void lookup(uint32_t state, uint32_t action, const Edge *& first,
+                const Edge *& last) const;
+};
+
+/* The immutable layout of the transitions of an LTS (compressed sparse
+   row): the edges of state i are stored in edges[offsets[i]], ...,
+   edges[offsets[i+1]-1]. Compared to a vector of LtsNode, this avoids
+   a separate allocation for each state, and keeps the edges of
+   consecutive states close in memory.
+   Since it is never modified in place while shared, a frozen layout is
+   reference counted and shared by the copies of an LTS (see Lts). */
+struct FrozenGraph {
+    vector<uint32_t> offsets;   /* numStates() + 1 elements. */
+    vector<Edge> edges;
+
+    bool empty() const { return offsets.empty(); }
+    void clear();
+};
+
 /* Private information associated to each LTS node. This information
    is not stored into the LtsNode class, because it is only necessary
    when parsing an FSP "process definition". In particular, we don't
@@ -105,23 +165,94 @@ class FspDriver;
 namespace fsp {
 
 class Lts;
+class NaryProduct;
+class LtlProperty;
 
-typedef void (*LtsVisitFunction)(int, const Lts&, const struct LtsNode&, void*);
+typedef void (*LtsVisitFunction)(int, const Lts&, const EdgeRange&, void*);
 
 struct LtsVisitObject {
     LtsVisitFunction vfp;
     void *opaque;
 };
 
+/* On-the-fly safety checking: the composition engine looks for
+   deadlocks and Error states while exploring the composite states,
+   and stops the exploration as soon as 'max' violations have been
+   found. The violations are reported into 'report', together with
+   the (shortest) traces that reach them. */
+struct SafetyCheck {
+    string name;
+    unsigned int max;
+    unsigned int found;
+    stringstream report;
+
+    SafetyCheck(const string& n, unsigned int m) : name(n), max(m),
+                                                   found(0) { }
+    bool stopped() const { return found >= max; }
+};
+
+/* A progress property to be checked, with its name. */
+typedef pair<string, const ProgressS *> ProgressCheck;
+
+
+/* A successor generator: the view of an LTS used by the analyses that
+   only need to explore it starting from the initial state (state 0),
+   like deadlock analysis and simulation. States are numbered in the
+   order they are discovered. It is implemented both by a stored LTS
+   (Lts) and by a composite LTS computed on demand (LazyLts). */
+class LtsGenerator {
+  protected:
+    /* Replace 'trace', the actions along 'path', with the trace of the
+       concrete LTS, if this one is a reduced view (see Symmetry). */
+    virtual void concrete_trace(const vector<unsigned int>& path,
+                                vector<unsigned int>& trace) const { }
+    void report_deadlock(stringstream& ss, unsigned int state,
+                         vector<unsigned int>& path,
+                         vector<unsigned int>& trace) const;
+
+  public:
+    string name;
+
+    virtual ~LtsGenerator() { }
+
+    /* The number of states discovered so far. */
+    virtual unsigned int discovered() const = 0;
+
+    /* The outgoing edges of the discovered state 'state'. The edges
+       are only valid until the next call. */
+    virtual EdgeRange successors(unsigned int state) const = 0;
+
+    virtual unsigned int stateType(unsigned int state) const = 0;
+
+    virtual int deadlockAnalysis(stringstream& ss) const;
+    int ltlAnalysis(const LtlProperty& property, stringstream& ss) const;
+    void simulate(Shell& sh, const ActionSetS *menu) const;
+};
+
 
 /* An LTS. */
-class Lts: public Symbol {
+class Lts: public Symbol, public LtsGenerator {
+    /* The transitions are stored in 'nodes' while the LTS is being
+       built or modified. A finished LTS is frozen (see freeze()): the
+       transitions are moved into 'frozen', and 'nodes' is empty. The
+       operators that modify the LTS thaw it first.
+       The frozen layout is shared by the copies of the LTS, so that
+       copying a finished LTS does not copy its transitions (copy on
+       write): they are copied by thaw(), or by remap_actions() when
+       the structure of the LTS does not change. */
     vector<LtsNode> nodes;
+    shared_ptr<FrozenGraph> frozen;
+
+    /* The predecessor index: the reverse of the transitions, where the
+       'dest' field of each edge is the source state. It is built on
+       demand by predecessors(), and dropped by thaw(). */
+    mutable FrozenGraph incoming;
+
     vector<LtsNodeInfo> infos;
     unsigned int end;
     unsigned int err;
 
-    set<unsigned int> alphabet;
+    ActionBitset alphabet;
 
     vector<TerminalSet> terminal_sets;
     bool terminal_sets_computed;
@@ -129,23 +260,37 @@ class Lts: public Symbol {
     void copy_node_in(int state, const Lts& lts, int i);
     void copy_node_out(Lts& lts, int i, int state);
     void copy_nodes_in(const Lts& lts);
+    void swap_nodes(Lts& lts);
 
     void update_composition(unsigned int idx, unsigned int dst_ip,
                             const fsp::Lts& p, unsigned int dst_iq,
-                            const fsp::Lts& q, unsigned int nq, Edge& e,
-                            map<unsigned int, unsigned int>& direct,
-                            vector<unsigned int>& inverse);
+                            const fsp::Lts& q, uint64_t nq, Edge& e,
+                            StateTable& direct);
     void compose_declarative(const Lts& p, const Lts& q);
     void compose_operational(const Lts& p, const Lts& q);
+    void compose_nary(const vector<const Lts *>& ltsv, bool reduction,
+                      SafetyCheck *check);
+    void compose_parallel(const vector<const Lts *>& ltsv, bool reduction);
+    void compose_external(const vector<const Lts *>& ltsv, bool reduction);
+    void compose_interleaving(const vector<const Lts *>& ltsv);
+    void compose_symmetric(Symmetry& sym);
 
     /* Pointer to a composition algorithm (member function). */
     typedef void (Lts::*ComposeAlgorithm)(const Lts&, const Lts&);
-    /* Pointer to the currently used composition algorithm. */
-    static ComposeAlgorithm compose_algorithm;
+    static ComposeAlgorithm select_algorithm(const Lts& p, const Lts& q);
 
     void compose(const Lts& p, const Lts& q);
+    void symmetric_trace(const vector<unsigned int>& path,
+                         vector<unsigned int>& trace,
+                         vector<uint32_t>& last) const;
+    void symmetric_actions(const vector<uint32_t>& start,
+                           ActionBitset& actions) const;
+    void remap_actions(const vector<uint32_t>& mapping);
+    bool parallel_terminal_sets();
+    Lts *expanded_lts();
+    bool symmetric_progress(const ProgressS& pr) const;
+    void describe_terminal_set(const TerminalSet& ts, string& result) const;
     void reduce(const Lts& unconnected);
-    void print_trace(const vector<int>& trace, stringstream& ss) const;
     void removeType(unsigned int type, unsigned int zero_idx,
                     bool call_reduce);
     void initial_partitions(list< set<unsigned int> >& partitions,
@@ -165,18 +310,83 @@ class Lts: public Symbol {
 
     friend class ::Serializer;
     friend class ::Deserializer;
+    friend class NaryProduct;
+    friend class Symmetry;
+
+  protected:
+    void concrete_trace(const vector<unsigned int>& path,
+                        vector<unsigned int>& trace) const;
 
   public:
-    string name;
+    /* Number of threads used by parallel composition. */
+    static unsigned int compose_jobs;
+
+    /* The deadlock and progress analysis of the LTSs with at least
+       this number of states use 'compose_jobs' threads. */
+    static unsigned int parallel_bfs_states;
+
+    /* Composition algorithm: chosen for each composition using a cost
+       model (ComposeAuto), or forced. */
+    static const int ComposeAuto = 0;
+    static const int ComposeDeclarative = 1;
+    static const int ComposeOperational = 2;
+    static int compose_selection;
+    static bool setComposeAlgorithm(const string& name);
+
+    /* If not empty, parallel composition is done in external memory,
+       using temporary files in this directory. The memory used for
+       sorting is limited to 'external_memory' bytes. */
+    static string external_dir;
+    static size_t external_memory;
+
+    /* If not NULL, this LTS only contains a representative state for
+       each orbit of the composite states (see Symmetry). The analyses
+       use it to report traces of the LTS without reduction. */
+    shared_ptr<Symmetry> symmetry;
+
+    /* If not NULL, this LTS has been composed with a reduction (it is
+       also set when 'symmetry' is), and only the deadlock analysis
+       (and the symmetric progress properties) can use it directly:
+       everything else uses unreduced(). */
+    shared_ptr<Reduction> reduction;
 
     Lts() { err = end = ~0U; }
     Lts(int); /* One state Lts: Stop, End or Error */
     Lts(const Lts& p, const Lts& q); /* Parallel composition */
-    int numStates() const { return nodes.size(); }
+    /* N-ary composition, optionally with partial order reduction
+       and on-the-fly safety checking. */
+    Lts(const vector< SmartPtr<Lts> >& ltsv, bool partial_order = false,
+        SafetyCheck *check = NULL);
+    Lts(const shared_ptr<Symmetry>& sym); /* Composition with symmetry reduction. */
+    int numStates() const {
+        return !frozen ? nodes.size() : frozen->offsets.size() - 1;
+    }
     int numTransitions() const;
+    EdgeRange edges(unsigned int state) const {
+        if (!frozen) {
+            return EdgeRange(nodes[state].children);
+        }
+        return EdgeRange(frozen->edges.data() + frozen->offsets[state],
+                         frozen->edges.data() + frozen->offsets[state + 1]);
+    }
+    bool isFrozen() const { return frozen.get() != NULL; }
+    void freeze();
+    void thaw();
+    Lts *unreduced();
+    unsigned int discovered() const { return numStates(); }
+    EdgeRange successors(unsigned int state) const {
+        return edges(state);
+    }
+    unsigned int stateType(unsigned int state) const {
+        return get_type(state);
+    }
+    EdgeRange predecessors(unsigned int state) const;
+    unsigned int coreachable(const vector<bool>& targets,
+                             vector<bool>& result) const;
     int deadlockAnalysis(stringstream& ss) const;
     int terminalSets();
     bool isDeterministic() const;
+    void indexActions(ActionIndex& ai) const;
     Lts& compose(const Lts& q);
     Lts& labeling(const SetS& labels);
     Lts& labeling(const string& label);
@@ -184,13 +394,19 @@ class Lts: public Symbol {
     Lts& relabeling(const SetS& newlabels, const SetS& oldlabels);
     Lts& relabeling(const SetS& newlabels, const string& oldlabel);
     Lts& hiding(const SetS& s, bool interface);
+    Lts& hiding(const set<unsigned int>& actions);
+    void hiddenActions(const SetS& s, bool interface,
+                       set<unsigned int>& result) const;
     Lts& priority(const SetS& s, bool low);
     Lts& property();
     int progress(const string& progress_name, const ProgressS& pr,
         stringstream& ss);
+    void progress(const vector<ProgressCheck>& checks,
+                  vector<string>& reports, vector<int>& violations);
+    bool progressNeedsUnreduced(const vector<ProgressCheck>& checks) const;
+    int ltlAnalysis(const LtlProperty& property, stringstream& ss);
     void visit(const struct LtsVisitObject&) const;
     void graphvizOutput(const char *filename, bool compress) const;
-    void simulate(Shell& sh, const ActionSetS *asv) const;
     void basic(const string& outfile, stringstream& ss) const;
     void minimize(stringstream& ss);
     void traces(stringstream& ss);
@@ -198,11 +414,16 @@ class Lts: public Symbol {
     void updateAlphabet(unsigned int action);
     int lookupAlphabet(unsigned int action) const;
     void mergeAlphabetInto(set<unsigned int>& actions) const;
+    void mergeAlphabetInto(ActionBitset& actions) const;
     void mergeAlphabetFrom(const set<unsigned int>& actions);
+    void mergeAlphabetFrom(const ActionBitset& actions);
     int alphabetSize() const { return alphabet.size(); }
     void printAlphabet(stringstream& ss, bool compress) const;
-    set<unsigned int> getAlphabet() const { return alphabet; }
+    set<unsigned int> getAlphabet() const { return alphabet.toSet(); }
     unsigned int append(const Lts&, unsigned int first);
+    unsigned int add_state(unsigned int type);
+    void add_edge(unsigned int state, const string& label,
+                  unsigned int dest);
     Lts& zerocat(const Lts& lts, const string& label);
     Lts& incompcat(const vector< SmartPtr<Lts> >& ltsv);
     Lts& zeromerge(const Lts& lts);
@@ -216,7 +437,7 @@ class Lts: public Symbol {
     unsigned int get_type(unsigned int state) const;
     void check_privs(set<unsigned int>& privs);
     void replace_priv(unsigned int new_priv, unsigned int old_priv);
-    vector<Edge> get_children(unsigned int state) const;
+    EdgeRange get_children(unsigned int state) const;
     bool in_tau_deadlock(unsigned int state) const;
     void reachable_actions_set(unsigned int state,
                                const set<unsigned int>& tau_dead_set,
@@ -232,6 +453,47 @@ class Lts: public Symbol {
     Symbol *clone() const;
 };
 
+/* A composite LTS whose states and transitions are computed on demand
+   from its components, so that exploring a part of it (e.g. in a
+   simulation) does not require to build the whole product. Only the
+   discovered composite states are stored. When explored in BFS order,
+   the states are numbered like the ones of the LTS built by
+   Lts(const vector< SmartPtr<Lts> >&).
+   The outgoing edges of the last 'cache_states' expanded states are
+   cached, so that they are not recomputed when a state is visited
+   again. */
+class LazyLts: public Symbol, public LtsGenerator {
+    struct Scratch;
+
+    vector< SmartPtr<Lts> > components;
+    vector<const Lts *> ltsv;
+    NaryProduct *product;
+    TreeTable *table;
+    Scratch *scratch;
+    ActionBitset alphabet;
+
+    /* 'hidden[a]' is set if the action 'a' is hidden (mapped to tau). */
+    vector<bool> hidden;
+
+    LazyLts(const LazyLts&);
+    LazyLts& operator=(const LazyLts&);
+
+  public:
+    /* Maximum number of states whose edges are cached (0 means no
+       caching). */
+    static unsigned int cache_states;
+
+    LazyLts(const vector< SmartPtr<Lts> >& v);
+    ~LazyLts();
+    unsigned int discovered() const;
+    EdgeRange successors(unsigned int state) const;
+    unsigned int stateType(unsigned int state) const;
+    LazyLts& hiding(const set<unsigned int>& actions);
+    set<unsigned int> getAlphabet() const { return alphabet.toSet(); }
+
+    const char *className() const { return "LazyLts"; }
+};
+
 fsp::Lts *err_if_not_lts(FspDriver& driver, Symbol *svp, const fsp::location& loc);
 
 struct LtsPtrS : public Symbol {
@@ -249,6 +511,20 @@ struct LtsVecS : public Symbol {
 void compress_action_labels(const set<unsigned int>& actions,
                             set<string>& result, bool compress);
 
+/* The reports of the analyses of a process (see analyze_processes()). */
+struct AnalysisReport {
+    string deadlock;
+    int deadlocks;
+    vector<string> progress;    /* One for each progress property. */
+    vector<int> violations;
+
+    AnalysisReport() : deadlocks(0) { }
+};
+
+void analyze_processes(const vector<Lts *>& ltsv, bool deadlock,
+                       bool graphviz, const vector<ProgressCheck>& checks,
+                       unsigned int jobs, vector<AnalysisReport>& reports);
+
 } /* namespace fsp */
 
 #endif
@@ -139,7 +139,7 @@ MonitorAnalyst::NodeClassifier::NodeClassifier
 }
 
 MonitorAnalyst::NodeType MonitorAnalyst::NodeClassifier::node_type
-(int node, const vector<Edge>& edges)
+(int node, const EdgeRange& edges)
 {
     if (cache.find(node) != cache.end()) return cache[node];
 
@@ -183,7 +183,7 @@ void MonitorAnalyst::MNFExtractor::internal_actions_lookahead(State state,
         MNF& mnf)
 {
     unsigned int marked_state = state;
-    vector<Edge> edges = lts.get_children(state);
+    EdgeRange edges = lts.get_children(state);
 
     while (true) {
         switch (classifier.node_type(state, edges)) {
@@ -262,7 +262,7 @@ void MonitorAnalyst::MNFExtractor::operator()(State state, MNF& mnf,
         throw runtime_error(fail_reasons[stochastic_node]);
     }
 
-    const vector<Edge>& edges = lts.get_children(state);
+    EdgeRange edges = lts.get_children(state);
 
     switch (classifier.node_type(state, edges)) {
         case HYBRID:
@@ -343,12 +343,12 @@ void MonitorAnalyst::TNFExtractor::complete_path(State node, TNF& tnf)
 {
     ActionSequence path = ActionSequence();
     State entry = node;
-    vector<Edge> edges;
     set<State> visited;
 
     do { /*TODO: what happens if we have to complete a path for a END state?*/
+        EdgeRange edges = lts.get_children(node);
+
         visited.insert(node);
-        edges = lts.get_children(node);
 
         if (edges.size() > 0) {
             path.push_back(edges[0].action);
@@ -407,7 +407,7 @@ void MonitorAnalyst::TNFExtractor::operator()(int node, TNF& tnf,
     }
 
     seen[node] = true;
-    const vector<Edge>& edges = lts.get_children(node);
+    EdgeRange edges = lts.get_children(node);
 
     switch (edges.size()) {
         case 0: {
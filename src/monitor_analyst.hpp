@@ -274,7 +274,7 @@ class MonitorAnalyst : public FspcAnalyst {
                  * @param node The node to classify
                  * @param edges The exit set of the node to classify
                  **/
-                NodeType node_type(State node, const std::vector<Edge>& edges);
+                NodeType node_type(State node, const EdgeRange& edges);
         };
 
         /**
@@ -196,14 +196,14 @@ void Deserializer::actions_table(fsp::ActionsTable &at, bool raw)
 }
 
 void serializeLtsVisitFunction(int state, const fsp::Lts& lts,
-                               const struct LtsNode& node, void *opaque)
+                               const EdgeRange& children, void *opaque)
 {
     Serializer *serp = static_cast<Serializer *>(opaque);
 
-    for (unsigned int i=0; i<node.children.size(); i++) {
+    for (unsigned int i=0; i<children.size(); i++) {
 	serp->integer(state, 1);
-	serp->integer(node.children[i].action, 1);
-	serp->integer(node.children[i].dest, 1);
+	serp->integer(children[i].action, 1);
+	serp->integer(children[i].dest, 1);
     }
 }
 
@@ -220,8 +220,8 @@ void Serializer::lts(const fsp::Lts& lts, bool raw)
 
     this->stl_string(lts.name, 1);
     this->integer(lts.numTransitions(), 1);
-    this->integer(lts.nodes.size(), 1);
-    for (unsigned int i=0; i<lts.nodes.size(); i++) {
+    this->integer(lts.numStates(), 1);
+    for (int i=0; i<lts.numStates(); i++) {
 	switch (lts.get_type(i)) {
 	    case LtsNode::End:
 		end = i;
@@ -239,7 +239,7 @@ void Serializer::lts(const fsp::Lts& lts, bool raw)
     lts.visit(lvo);
 
     this->integer(lts.alphabet.size(), 1);
-    for (set<unsigned int>::iterator it=lts.alphabet.begin();
+    for (fsp::ActionBitset::iterator it=lts.alphabet.begin();
 			it!=lts.alphabet.end(); it++) {
 	this->integer(*it, 1);
     }
@@ -261,6 +261,7 @@ void Deserializer::lts(fsp::Lts &lts, bool raw)
     }
 
     lts.terminal_sets_computed = false;
+    lts.thaw();
 
     this->stl_string(lts.name, 1);
     this->integer(x, 1); ntr = x;
@@ -288,6 +289,8 @@ void Deserializer::lts(fsp::Lts &lts, bool raw)
 	this->integer(y, 1);
 	lts.updateAlphabet(y);
     }
+
+    lts.freeze();
 }
 
 void Serializer::set_value(const struct fsp::SetS& setv, bool raw)
@@ -331,7 +334,7 @@ void Serializer::action_set_value(const struct fsp::ActionSetS& asv, bool raw)
     }
 
     this->integer(asv.actions.size(), 1);
-    for (set<unsigned int>::iterator it = asv.actions.begin();
+    for (fsp::ActionBitset::iterator it = asv.actions.begin();
                     it != asv.actions.end(); it++) {
 	this->integer(*it, 1);
     }
@@ -25,6 +25,9 @@
 /* Lts definitions and operations. */
 #include "lts.hpp"
 
+/* Linear temporal logic properties. */
+#include "ltl.hpp"
+
 /* Helper functions. */
 #include "helpers.hpp"
 
@@ -36,6 +39,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cstring>       /* strlen() */
+#include <cstdlib>       /* strtol() */
 #include <unistd.h>      /* fork() */
 #include <sys/wait.h>    /* waitpid() */
 #include <ncurses.h>
@@ -64,6 +68,11 @@ Shell::Shell(FspDriver& cr, istream& inr) : c(cr), code_generator(cr), in(inr)
     help_map["progress"] = HelpEntry("progress [FSP_NAME]",
             "Run progress analysis on "
             "the specified FSP or on every FSP");
+    help_map["ltl"] = HelpEntry("ltl FSP_NAME FORMULA",
+            "Check that every infinite execution of the "
+            "specified FSP satisfies the linear temporal logic "
+            "formula over actions FORMULA, e.g. '[] <> eat' "
+            "(operators: ! && || -> <-> X <> [] U W R)");
     help_map["simulate"] = HelpEntry("simulate FSP_NAME",
             "Run an interactive simulation of "
             "the specified FSP");
@@ -144,6 +153,7 @@ Shell::Shell(FspDriver& cr, istream& inr) : c(cr), code_generator(cr), in(inr)
     cmd_map["ls"] = &Shell::ls;
     cmd_map["safety"] = &Shell::safety;
     cmd_map["progress"] = &Shell::progress;
+    cmd_map["ltl"] = &Shell::ltl;
     cmd_map["simulate"] = &Shell::simulate;
     cmd_map["basic"] = &Shell::basic;
 #ifdef WITH_CODE
@@ -171,6 +181,13 @@ Shell::Shell(FspDriver& cr, istream& inr) : c(cr), code_generator(cr), in(inr)
      */
     options["label-compression"] = ShellOption("label-compression", "y",
             ShellOption::Boolean);
+    options["jobs"] = ShellOption("jobs", int2string(c.cop.jobs),
+            ShellOption::Positive);
+    options["compose-algorithm"] = ShellOption("compose-algorithm",
+            c.cop.compose_algorithm, ShellOption::String);
+    options["lazy"] = ShellOption("lazy", "y", ShellOption::Boolean);
+    options["lazy-cache"] = ShellOption("lazy-cache",
+            int2string(fsp::LazyLts::cache_states), ShellOption::Positive);
 
     ifframes.push(IfFrame(true, false, false));
 }
@@ -317,7 +334,17 @@ of the 'eol' parameter. */
 
 void BatchShell::putsstream(stringstream& ss, bool eol)
 {
-    cout << ss.str();
+    string line;
+
+    /* Consume the content, like InteractiveShell::putsstream() does,
+       so that the caller can reuse 'ss' (e.g. in simulate()) without
+       printing the same lines again. */
+    while (getline(ss, line)) {
+        cout << line;
+        if (!ss.eof()) {
+            cout << "\n";
+        }
+    }
 }
 
 /* The more portable way I found out to implement 'isprint'. */
@@ -605,7 +632,13 @@ int Shell::safety(const vector<string> &args, stringstream& ss)
     if (args.size()) {
         fsp::SmartPtr<fsp::Lts> lts;
 
-        /* Deadlock analysis on args[0]. */
+        /* Deadlock analysis on args[0]. A composite process that has
+           not been computed yet is explored lazily. */
+        fsp::SmartPtr<fsp::LazyLts> lazy = getLazyLts(args[0]);
+
+        if (lazy) {
+            return lazy->deadlockAnalysis(ss);
+        }
         lts = c.getLts(args[0], true);
         if (lts == NULL) {
             ss << "Process " << args[0] << " not found\n";
@@ -613,13 +646,20 @@ int Shell::safety(const vector<string> &args, stringstream& ss)
         }
         deadlocks = lts->deadlockAnalysis(ss);
     } else {
-        fsp::Lts *lts;
+        vector<fsp::Lts *> ltsv;
+        vector<fsp::AnalysisReport> reports;
 
         /* Deadlock analysis on every process. */
         for (it=c.processes.table.begin();
                 it!=c.processes.table.end(); it++) {
-            lts = fsp::is<fsp::Lts>(it->second);
-            deadlocks += lts->deadlockAnalysis(ss);
+            ltsv.push_back(fsp::is<fsp::Lts>(it->second));
+        }
+        fsp::analyze_processes(ltsv, true, false,
+                               vector<fsp::ProgressCheck>(), c.cop.jobs,
+                               reports);
+        for (unsigned int i=0; i<reports.size(); i++) {
+            ss << reports[i].deadlock;
+            deadlocks += reports[i].deadlocks;
         }
     }
 
@@ -631,10 +671,19 @@ int Shell::progress(const vector<string> &args, stringstream& ss)
     map<string, fsp::Symbol *>::iterator it;
     map<string, fsp::Symbol *>::iterator jt;
     fsp::ProgressS *pv;
+    vector<fsp::ProgressCheck> checks;
     int npv = 0;    /* Number of progress violations. */
 
+    for (jt=c.progresses.table.begin();
+            jt!=c.progresses.table.end(); jt++) {
+        pv = fsp::is<fsp::ProgressS>(jt->second);
+        checks.push_back(fsp::ProgressCheck(jt->first, pv));
+    }
+
     if (args.size()) {
         fsp::SmartPtr<fsp::Lts> lts;
+        vector<string> reports;
+        vector<int> violations;
 
         /* Progress analysis on args[0]. */
         lts = c.getLts(args[0], true);
@@ -642,22 +691,26 @@ int Shell::progress(const vector<string> &args, stringstream& ss)
             ss << "Process " << args[0] << " not found\n";
             return -1;
         }
-        for (it=c.progresses.table.begin();
-                it!=c.progresses.table.end(); it++) {
-            pv = fsp::is<fsp::ProgressS>(it->second);
-            npv = lts->progress(it->first, *pv, ss);
+        lts->progress(checks, reports, violations);
+        for (unsigned int k=0; k<checks.size(); k++) {
+            ss << reports[k];
+            npv += violations[k];
         }
     } else {
-        fsp::Lts *lts;
+        vector<fsp::Lts *> ltsv;
+        vector<fsp::AnalysisReport> reports;
 
         /* Progress analysis on every process. */
         for (it=c.processes.table.begin();
                 it!=c.processes.table.end(); it++) {
-            lts = fsp::is<fsp::Lts>(it->second);
-            for (jt=c.progresses.table.begin();
-                    jt!=c.progresses.table.end(); jt++) {
-                pv = fsp::is<fsp::ProgressS>(jt->second);
-                npv += lts->progress(jt->first, *pv, ss);
+            ltsv.push_back(fsp::is<fsp::Lts>(it->second));
+        }
+        fsp::analyze_processes(ltsv, false, false, checks, c.cop.jobs,
+                               reports);
+        for (unsigned int i=0; i<reports.size(); i++) {
+            for (unsigned int k=0; k<checks.size(); k++) {
+                ss << reports[i].progress[k];
+                npv += reports[i].violations[k];
             }
         }
     }
@@ -665,22 +718,80 @@ int Shell::progress(const vector<string> &args, stringstream& ss)
     return npv;
 }
 
-int Shell::simulate(const vector<string> &args, stringstream& ss)
+/* Return a lazy view of the composite process 'name' (see
+   FspDriver::getLazyLts()), or NULL if the process should be computed
+   as usual. */
+fsp::SmartPtr<fsp::LazyLts> Shell::getLazyLts(const string& name)
+{
+    if (options["lazy"].get() != "y") {
+        return NULL;
+    }
+    fsp::LazyLts::cache_states = atoi(options["lazy-cache"].get().c_str());
+
+    return c.getLazyLts(name);
+}
+
+int Shell::ltl(const vector<string> &args, stringstream& ss)
 {
     fsp::SmartPtr<fsp::Lts> lts;
-    fsp::ActionSetS *menu = NULL;
+    fsp::SmartPtr<fsp::LazyLts> lazy;
+    fsp::LtlProperty property;
+    string formula;
+    string error;
 
-    if (!args.size()) {
+    if (args.size() < 2) {
         ss << "Invalid command: try 'help'\n";
         return -1;
     }
 
+    merge_string_vec(vector<string>(args.begin() + 1, args.end()),
+                     formula, " ");
+    if (!property.build(formula, error)) {
+        ss << "    invalid formula '" << formula << "': " << error << "\n";
+        return -1;
+    }
+
+    /* A composite process that has not been computed yet is checked
+       without computing it, exploring the states on demand. */
+    lazy = getLazyLts(args[0]);
+    if (lazy) {
+        return lazy->ltlAnalysis(property, ss);
+    }
     lts = c.getLts(args[0], true);
     if (lts == NULL) {
         ss << "Process " << args[0] << " not found\n";
         return -1;
     }
 
+    return lts->ltlAnalysis(property, ss);
+}
+
+int Shell::simulate(const vector<string> &args, stringstream& ss)
+{
+    fsp::SmartPtr<fsp::Lts> lts;
+    fsp::SmartPtr<fsp::LazyLts> lazy;
+    fsp::LtsGenerator *generator;
+    fsp::ActionSetS *menu = NULL;
+
+    if (!args.size()) {
+        ss << "Invalid command: try 'help'\n";
+        return -1;
+    }
+
+    /* A composite process that has not been computed yet is simulated
+       without computing it, exploring the states on demand. */
+    lazy = getLazyLts(args[0]);
+    if (lazy) {
+        generator = lazy;
+    } else {
+        lts = c.getLts(args[0], true);
+        if (lts == NULL) {
+            ss << "Process " << args[0] << " not found\n";
+            return -1;
+        }
+        generator = lts->unreduced();
+    }
+
     if (args.size() >= 2) {
         fsp::Symbol *svp;
 
@@ -692,7 +803,7 @@ int Shell::simulate(const vector<string> &args, stringstream& ss)
     }
 
     history_enable(false);
-    lts->simulate(*this, menu);
+    generator->simulate(*this, menu);
     history_enable(true);
 
     return 0;
@@ -720,7 +831,7 @@ int Shell::basic(const vector<string> &args, stringstream& ss)
         outfile = args[0] + ".bfsp";
     }
 
-    lts->basic(outfile, ss);
+    lts->unreduced()->basic(outfile, ss);
 
     return 0;
 }
@@ -774,6 +885,7 @@ int Shell::alpha(const vector<string> &args, stringstream& ss)
 int Shell::see(const vector<string> &args, stringstream& ss)
 {
     fsp::SmartPtr<fsp::Lts> lts;
+    fsp::Lts *graph;
     string tmp_name, stdout_tmp_name;
     pid_t drawer;
     const char *exec_errmsg;
@@ -794,13 +906,14 @@ int Shell::see(const vector<string> &args, stringstream& ss)
         ss << "Process " << args[0] << " not found\n";
         return -1;
     }
+    graph = lts->unreduced();
 
-    if (lts->numStates() == 0) {
+    if (graph->numStates() == 0) {
         ss << "Lts " << args[0] << " is empty\n";
         return 0;
     }
 
-    if (lts->numStates() > SEE_MAX_STATES) {
+    if (graph->numStates() > SEE_MAX_STATES) {
         ss << "Lts " << args[0] << " has too many states\n";
         return 0;
     }
@@ -808,7 +921,7 @@ int Shell::see(const vector<string> &args, stringstream& ss)
     /* Generate the graphivz output into a temporary file (whose name does
        not collide with other fspc instances). */
     tmp_name = get_tmp_name("", "gv");
-    lts->graphvizOutput(tmp_name.c_str(), options["label-compression"].get() == "y");
+    graph->graphvizOutput(tmp_name.c_str(), options["label-compression"].get() == "y");
 
     /* UNIX-specific section. */
     stdout_tmp_name = get_tmp_name("", "stdout.tmp");
@@ -886,7 +999,7 @@ int Shell::print(const vector<string> &args, stringstream& ss)
     }
     filename = args[0] + ".gv";
 
-    lts->graphvizOutput(filename.c_str(), options["label-compression"].get() == "y");
+    lts->unreduced()->graphvizOutput(filename.c_str(), options["label-compression"].get() == "y");
 
     if (args.size() > 1) {
         if (args[1] != "png" && args[1] != "pdf") {
@@ -999,7 +1112,7 @@ int Shell::minimize(const vector<string> &args, stringstream& ss)
         return -1;
     }
 
-    lts->minimize(ss);
+    lts->unreduced()->minimize(ss);
 
     return 0;
 }
@@ -1019,7 +1132,7 @@ int Shell::traces(const vector<string> &args, stringstream& ss)
         return -1;
     }
 
-    lts->traces(ss);
+    lts->unreduced()->traces(ss);
 
     return 0;
 }
@@ -1185,7 +1298,7 @@ int Shell::graphviz(const vector<string> &args, stringstream& ss)
         outfile = args[0] + ".gv";
     }
 
-    lts->graphvizOutput(outfile.c_str(), options["label-compression"].get() == "y");
+    lts->unreduced()->graphvizOutput(outfile.c_str(), options["label-compression"].get() == "y");
 
     return 0;
 }
@@ -1213,10 +1326,20 @@ int Shell::option(const vector<string>& args, stringstream& ss)
                argument. */
             int ret;
 
-            ret = options[args[0]].set(args[1]);
+            if (args[0] == "compose-algorithm" &&
+                    !fsp::Lts::setComposeAlgorithm(args[1])) {
+                ret = -1;
+            } else {
+                ret = options[args[0]].set(args[1]);
+            }
 
             if (ret) {
                 ss << "    Invalid option value\n";
+            } else if (args[0] == "jobs") {
+                /* The same number of threads is used to compose and to
+                   analyze the processes (see fsp::analyze_processes()). */
+                c.cop.jobs = atoi(args[1].c_str());
+                fsp::Lts::compose_jobs = c.cop.jobs;
             }
 
             return ret;
@@ -1566,6 +1689,15 @@ int ShellOption::set(const string& val)
         case String:
             break;
 
+        case Positive: {
+            char *end;
+
+            if (val.empty() || strtol(val.c_str(), &end, 10) < 1 || *end) {
+                return -1;
+            }
+            break;
+        }
+
         default:
             return -1;
     }
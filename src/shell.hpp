@@ -175,6 +175,7 @@ struct ShellOption {
     static const unsigned int Null      = 0;
     static const unsigned int Boolean   = 1;
     static const unsigned int String    = 2;
+    static const unsigned int Positive  = 3;
 };
 
 class FspDriver;
@@ -223,9 +224,12 @@ class Shell {
         /* Shell return value, set by the "exit" command. */
         int return_value;
 
+        fsp::SmartPtr<fsp::LazyLts> getLazyLts(const string& name);
+
         int ls(const vector<string>& args, stringstream& ss);
         int safety(const vector<string>& args, stringstream& ss);
         int progress(const vector<string>& args, stringstream& ss);
+        int ltl(const vector<string>& args, stringstream& ss);
         int simulate(const vector<string>& args, stringstream& ss);
         int basic(const vector<string>& args, stringstream& ss);
         int monitor(const vector<string>& args, stringstream& ss);
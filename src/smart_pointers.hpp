@@ -62,6 +62,7 @@ class SmartPtr {
         operator T*() const;
         ~SmartPtr();
         void clear();
+        void swap(SmartPtr& p);
 };
 
 
@@ -201,5 +202,16 @@ void fsp::SmartPtr<T>::clear()
     ptr = NULL;
 }
 
+/* Exchange the objects referenced by *this and 'p'. The refcounts
+   do not change. */
+template <class T>
+void fsp::SmartPtr<T>::swap(fsp::SmartPtr<T>& p)
+{
+    T *tmp = ptr;
+
+    ptr = p.ptr;
+    p.ptr = tmp;
+}
+
 }  /* namespace fsp */
 
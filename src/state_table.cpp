@@ -0,0 +1,460 @@
+/*
+ *  fspc composite state table implementation
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "state_table.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <cassert>
+
+using namespace std;
+
+
+/* ========================== StateTable ============================ */
+const uint32_t fsp::StateTable::Empty;
+
+fsp::StateTable::StateTable(uint64_t estimate)
+{
+    uint64_t size = 16;
+
+    /* Keep the load factor below 1/2. */
+    while (size < 2 * estimate && size < (1ULL << 33)) {
+        size <<= 1;
+    }
+
+    slots.assign(size, Empty);
+    mask = size - 1;
+    keys.reserve(estimate);
+}
+
+/* A 64 bit mixing function (the finalizer of MurmurHash3), so that
+   structured keys like 'ip*nq + iq' spread uniformly over the slots. */
+uint64_t fsp::StateTable::hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+
+    return key;
+}
+
+/* Double the number of slots and reinsert all the indexes. */
+void fsp::StateTable::grow()
+{
+    uint64_t size = slots.size() << 1;
+
+    slots.assign(size, Empty);
+    mask = size - 1;
+
+    for (uint32_t idx = 0; idx < keys.size(); idx++) {
+        uint64_t h = hash(keys[idx]) & mask;
+
+        while (slots[h] != Empty) {
+            h = (h + 1) & mask;
+        }
+        slots[h] = idx;
+    }
+}
+
+/* Lookup 'key' into the table, inserting it if it is not already there.
+   The index associated to 'key' is returned, and 'inserted' tells the
+   caller whether a new index has been allocated. */
+uint32_t fsp::StateTable::insert(uint64_t key, bool& inserted)
+{
+    uint64_t h = hash(key) & mask;
+    uint32_t idx;
+
+    while ((idx = slots[h]) != Empty) {
+        if (keys[idx] == key) {
+            inserted = false;
+            return idx;
+        }
+        h = (h + 1) & mask;
+    }
+
+    if (keys.size() == Empty) {
+        /* LTS state indexes are 32 bit wide. */
+        cerr << "StateTable: too many states\n";
+        exit(EXIT_FAILURE);
+    }
+
+    idx = keys.size();
+    slots[h] = idx;
+    keys.push_back(key);
+    inserted = true;
+
+    if (2 * keys.size() > slots.size()) {
+        grow();
+    }
+
+    return idx;
+}
+
+/* Return the index associated to 'key', or ~0U if 'key' is not in
+   the table. */
+uint32_t fsp::StateTable::lookup(uint64_t key) const
+{
+    uint64_t h = hash(key) & mask;
+    uint32_t idx;
+
+    while ((idx = slots[h]) != Empty) {
+        if (keys[idx] == key) {
+            return idx;
+        }
+        h = (h + 1) & mask;
+    }
+
+    return Empty;
+}
+
+
+/* ========================== TupleTable ============================ */
+const uint32_t fsp::TupleTable::Empty;
+
+fsp::TupleTable::TupleTable(unsigned int w, uint64_t estimate) : width(w)
+{
+    uint64_t size = 16;
+
+    assert(width);
+
+    /* Keep the load factor below 1/2. */
+    while (size < 2 * estimate && size < (1ULL << 33)) {
+        size <<= 1;
+    }
+
+    slots.assign(size, Empty);
+    mask = size - 1;
+    keys.reserve(estimate * width);
+}
+
+uint64_t fsp::TupleTable::hash(const uint32_t *tuple) const
+{
+    uint64_t h = width;
+
+    for (unsigned int i = 0; i < width; i++) {
+        h = (h ^ tuple[i]) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+
+    return StateTable::hash(h);
+}
+
+bool fsp::TupleTable::equal(uint32_t idx, const uint32_t *tuple) const
+{
+    const uint32_t *k = &keys[idx * width];
+
+    for (unsigned int i = 0; i < width; i++) {
+        if (k[i] != tuple[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Double the number of slots and reinsert all the indexes. */
+void fsp::TupleTable::grow()
+{
+    uint64_t size = slots.size() << 1;
+
+    slots.assign(size, Empty);
+    mask = size - 1;
+
+    for (uint32_t idx = 0; idx < this->size(); idx++) {
+        uint64_t h = hash(key(idx)) & mask;
+
+        while (slots[h] != Empty) {
+            h = (h + 1) & mask;
+        }
+        slots[h] = idx;
+    }
+}
+
+/* Lookup 'tuple' into the table, inserting a copy of it if it is not
+   already there. The index associated to 'tuple' is returned, and
+   'inserted' tells the caller whether a new index has been allocated. */
+uint32_t fsp::TupleTable::insert(const uint32_t *tuple, bool& inserted)
+{
+    uint64_t h = hash(tuple) & mask;
+    uint32_t idx;
+
+    while ((idx = slots[h]) != Empty) {
+        if (equal(idx, tuple)) {
+            inserted = false;
+            return idx;
+        }
+        h = (h + 1) & mask;
+    }
+
+    if (size() == Empty) {
+        /* LTS state indexes are 32 bit wide. */
+        cerr << "TupleTable: too many states\n";
+        exit(EXIT_FAILURE);
+    }
+
+    idx = size();
+    slots[h] = idx;
+    keys.insert(keys.end(), tuple, tuple + width);
+    inserted = true;
+
+    if (2 * uint64_t(size()) > slots.size()) {
+        grow();
+    }
+
+    return idx;
+}
+
+/* Return the index associated to 'tuple', or ~0U if 'tuple' is not in
+   the table. */
+uint32_t fsp::TupleTable::lookup(const uint32_t *tuple) const
+{
+    uint64_t h = hash(tuple) & mask;
+    uint32_t idx;
+
+    while ((idx = slots[h]) != Empty) {
+        if (equal(idx, tuple)) {
+            return idx;
+        }
+        h = (h + 1) & mask;
+    }
+
+    return Empty;
+}
+
+
+/* ===================== ConcurrentTupleTable ======================= */
+fsp::ConcurrentTupleTable::ConcurrentTupleTable(unsigned int w,
+                                                unsigned int nshards,
+                                                uint64_t estimate)
+                                                : width(w), next(0)
+{
+    assert(nshards);
+
+    for (unsigned int i = 0; i < nshards; i++) {
+        shards.push_back(new Shard(width, estimate / nshards));
+    }
+}
+
+fsp::ConcurrentTupleTable::~ConcurrentTupleTable()
+{
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        delete shards[i];
+    }
+}
+
+/* Lookup 'tuple' into the table, inserting a copy of it if it is not
+   already there. This method can be called concurrently. */
+uint32_t fsp::ConcurrentTupleTable::insert(const uint32_t *tuple,
+                                           bool& inserted)
+{
+    uint64_t h = width;
+    uint32_t idx;
+
+    for (unsigned int i = 0; i < width; i++) {
+        h = h * 31 + tuple[i];
+    }
+
+    Shard& shard = *shards[StateTable::hash(h) % shards.size()];
+    lock_guard<mutex> guard(shard.lock);
+
+    idx = shard.table.insert(tuple, inserted);
+    if (inserted) {
+        uint32_t id = next++;
+
+        if (id == ~0U) {
+            /* LTS state indexes are 32 bit wide. */
+            cerr << "ConcurrentTupleTable: too many states\n";
+            exit(EXIT_FAILURE);
+        }
+        shard.ids.push_back(id);
+    }
+
+    return shard.ids[idx];
+}
+
+
+/* ========================== TreeTable ============================= */
+fsp::TreeTable::TreeTable(const vector<uint32_t>& sizes, uint64_t estimate)
+                            : width(sizes.size())
+{
+    unsigned int used = 0;
+
+    assert(width);
+
+    for (unsigned int i = 0; i < width; i++) {
+        unsigned int b = 0;
+
+        while (b < 32 && (uint64_t(1) << b) < sizes[i]) {
+            b++;
+        }
+        bits.push_back(b);
+
+        /* Start a new group if this component does not fit in the
+           current one. */
+        if (i == 0 || used + b > 64) {
+            group.push_back(i);
+            used = 0;
+        }
+        used += b;
+    }
+    group.push_back(width);
+
+    build(0, group.size() - 1, true, estimate);
+}
+
+fsp::TreeTable::~TreeTable()
+{
+    for (unsigned int i = 0; i < tree.size(); i++) {
+        delete tree[i].table;
+    }
+}
+
+/* Build the subtree covering the groups [lo, hi), returning the index
+   of its root. */
+unsigned int fsp::TreeTable::build(unsigned int lo, unsigned int hi,
+                                   bool root, uint64_t estimate)
+{
+    unsigned int idx = tree.size();
+
+    tree.push_back(Node());
+    tree[idx].lo = lo;
+    tree[idx].hi = hi;
+    tree[idx].table = NULL;
+
+    if (hi - lo == 1) {
+        unsigned int b = 0;
+
+        for (unsigned int i = group[lo]; i < group[hi]; i++) {
+            b += bits[i];
+        }
+        /* Packed words that fit in 31 bits are used as ids, so that
+           they cannot be confused with ~0U (not found). */
+        if (root || b > 31) {
+            tree[idx].table = new StateTable(root ? estimate : 0);
+        }
+    } else {
+        unsigned int mid = (lo + hi) / 2;
+        unsigned int left = build(lo, mid, false, 0);
+        unsigned int right = build(mid, hi, false, 0);
+
+        tree[idx].left = left;
+        tree[idx].right = right;
+        tree[idx].table = new StateTable(root ? estimate : 0);
+    }
+
+    return idx;
+}
+
+/* Bit-pack the indexes of the components in group 'g'. */
+uint64_t fsp::TreeTable::pack(unsigned int g, const uint32_t *tuple) const
+{
+    uint64_t v = 0;
+    unsigned int shift = 0;
+
+    for (unsigned int i = group[g]; i < group[g + 1]; i++) {
+        v |= uint64_t(tuple[i]) << shift;
+        shift += bits[i];
+    }
+
+    return v;
+}
+
+uint32_t fsp::TreeTable::insert(unsigned int node, const uint32_t *tuple,
+                                bool& inserted)
+{
+    const Node& nd = tree[node];
+    uint64_t key;
+
+    if (nd.hi - nd.lo == 1) {
+        key = pack(nd.lo, tuple);
+        if (!nd.table) {
+            inserted = false;
+            return key;
+        }
+    } else {
+        key = (uint64_t(insert(nd.left, tuple, inserted)) << 32) |
+                                    insert(nd.right, tuple, inserted);
+    }
+
+    return nd.table->insert(key, inserted);
+}
+
+/* Lookup 'tuple' into the table, inserting it if it is not already
+   there. The index associated to 'tuple' is returned, and 'inserted'
+   tells the caller whether a new index has been allocated. */
+uint32_t fsp::TreeTable::insert(const uint32_t *tuple, bool& inserted)
+{
+    return insert(0, tuple, inserted);
+}
+
+uint32_t fsp::TreeTable::lookup(unsigned int node,
+                                const uint32_t *tuple) const
+{
+    const Node& nd = tree[node];
+    uint32_t left, right;
+
+    if (nd.hi - nd.lo == 1) {
+        uint64_t key = pack(nd.lo, tuple);
+
+        return nd.table ? nd.table->lookup(key) : uint32_t(key);
+    }
+
+    left = lookup(nd.left, tuple);
+    if (left == ~0U) {
+        return ~0U;
+    }
+    right = lookup(nd.right, tuple);
+    if (right == ~0U) {
+        return ~0U;
+    }
+
+    return nd.table->lookup((uint64_t(left) << 32) | right);
+}
+
+/* Return the index associated to 'tuple', or ~0U if 'tuple' is not in
+   the table. */
+uint32_t fsp::TreeTable::lookup(const uint32_t *tuple) const
+{
+    return lookup(0, tuple);
+}
+
+void fsp::TreeTable::unpack(unsigned int node, uint32_t id,
+                            uint32_t *tuple) const
+{
+    const Node& nd = tree[node];
+    uint64_t key = nd.table ? nd.table->key(id) : id;
+
+    if (nd.hi - nd.lo == 1) {
+        for (unsigned int i = group[nd.lo]; i < group[nd.lo + 1]; i++) {
+            tuple[i] = key & ((uint64_t(1) << bits[i]) - 1);
+            key >>= bits[i];
+        }
+    } else {
+        unpack(nd.left, key >> 32, tuple);
+        unpack(nd.right, key & 0xffffffff, tuple);
+    }
+}
+
+/* Store into 'tuple' the tuple associated to the index 'idx'. */
+void fsp::TreeTable::key(uint32_t idx, uint32_t *tuple) const
+{
+    unpack(0, idx, tuple);
+}
@@ -0,0 +1,157 @@
+/*
+ *  fspc composite state table implementation
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __STATE__TABLE__HH
+#define __STATE__TABLE__HH
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+using namespace std;
+
+
+namespace fsp {
+
+/* A flat hash table that maps composite state keys (e.g. 'ip*nq + iq'
+   for the product of two LTSs) to LTS state indexes. Indexes are
+   assigned in insertion order, starting from 0, so the table also
+   works as the inverse mapping 'index --> key'.
+
+   The table uses open addressing with linear probing. The slots only
+   store indexes, while the keys are stored once, in the 'keys' array
+   (indexed by state). The table is initially sized using an estimate
+   of the number of states, and it is grown (with rehashing) when the
+   load factor exceeds 1/2. */
+class StateTable {
+    static const uint32_t Empty = ~0U;
+
+    vector<uint32_t> slots;
+    vector<uint64_t> keys;
+    uint64_t mask;
+
+    void grow();
+
+  public:
+    StateTable(uint64_t estimate);
+    static uint64_t hash(uint64_t key);
+    uint32_t insert(uint64_t key, bool& inserted);
+    uint32_t lookup(uint64_t key) const;
+    uint64_t key(uint32_t idx) const { return keys[idx]; }
+    uint32_t size() const { return keys.size(); }
+};
+
+/* Same as StateTable, but the keys are tuples of 'width' state
+   indexes (e.g. '(s1, s2, ..., sn)' for the product of n LTSs), so
+   that the number of components is not limited by the size of a
+   machine word. The tuples are stored back to back in 'keys'. */
+class TupleTable {
+    static const uint32_t Empty = ~0U;
+
+    unsigned int width;
+    vector<uint32_t> slots;
+    vector<uint32_t> keys;
+    uint64_t mask;
+
+    uint64_t hash(const uint32_t *tuple) const;
+    bool equal(uint32_t idx, const uint32_t *tuple) const;
+    void grow();
+
+  public:
+    TupleTable(unsigned int w, uint64_t estimate);
+    uint32_t insert(const uint32_t *tuple, bool& inserted);
+    uint32_t lookup(const uint32_t *tuple) const;
+    const uint32_t *key(uint32_t idx) const { return &keys[idx * width]; }
+    uint32_t size() const { return keys.size() / width; }
+};
+
+/* Same as TupleTable, but the tuples are stored in compressed form,
+   so that the memory used per state does not grow with the number of
+   components:
+     - the components are split into groups of adjacent components,
+       and the indexes of each group are bit-packed into a 64 bit word,
+       using ceil(log2(n_i)) bits for a component with n_i states;
+     - the groups are the leaves of a balanced binary tree, and each
+       node of the tree hash-conses the pairs (left id, right id) into
+       a StateTable, so that common sub-tuples are stored only once
+       (tree compression). Leaves whose packed word fits in 31 bits
+       are used directly as ids.
+   The ids of the root table are the indexes of the tuples. */
+class TreeTable {
+    struct Node {
+        unsigned int lo, hi;    /* Range of groups covered. */
+        unsigned int left, right;
+        StateTable *table;
+    };
+
+    unsigned int width;
+    vector<unsigned int> bits;  /* Bits used by each component. */
+    vector<unsigned int> group; /* Group g is [group[g], group[g+1]). */
+    vector<Node> tree;          /* The root is tree[0]. */
+
+    unsigned int build(unsigned int lo, unsigned int hi, bool root,
+                       uint64_t estimate);
+    uint64_t pack(unsigned int g, const uint32_t *tuple) const;
+    uint32_t insert(unsigned int node, const uint32_t *tuple,
+                    bool& inserted);
+    uint32_t lookup(unsigned int node, const uint32_t *tuple) const;
+    void unpack(unsigned int node, uint32_t id, uint32_t *tuple) const;
+
+    TreeTable(const TreeTable&);
+    TreeTable& operator=(const TreeTable&);
+
+  public:
+    TreeTable(const vector<uint32_t>& sizes, uint64_t estimate);
+    ~TreeTable();
+    uint32_t insert(const uint32_t *tuple, bool& inserted);
+    uint32_t lookup(const uint32_t *tuple) const;
+    void key(uint32_t idx, uint32_t *tuple) const;
+    uint32_t size() const { return tree[0].table->size(); }
+};
+
+/* A tuple table that can be shared by multiple threads. The table is
+   split into shards, each one being a TupleTable protected by its own
+   lock. Indexes are allocated from a shared counter, so they are
+   unique but they do not reflect the order of insertion. */
+class ConcurrentTupleTable {
+    struct Shard {
+        mutex lock;
+        TupleTable table;
+        vector<uint32_t> ids;   /* Maps shard indexes to indexes. */
+
+        Shard(unsigned int w, uint64_t estimate) : table(w, estimate) { }
+    };
+
+    unsigned int width;
+    vector<Shard *> shards;
+    atomic<uint32_t> next;
+
+  public:
+    ConcurrentTupleTable(unsigned int w, unsigned int nshards,
+                         uint64_t estimate);
+    ~ConcurrentTupleTable();
+    uint32_t insert(const uint32_t *tuple, bool& inserted);
+    uint32_t size() const { return next; }
+};
+
+}  /* namespace fsp */
+
+#endif
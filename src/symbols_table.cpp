@@ -456,7 +456,7 @@ fsp::Symbol *fsp::PriorityS::clone() const
 /* =========================== ActionSetS ========================= */
 bool fsp::ActionSetS::add(unsigned int a)
 {
-    return actions.insert(a).second;
+    return actions.insert(a);
 }
 
 bool fsp::ActionSetS::lookup(unsigned int a) const
@@ -475,7 +475,7 @@ void fsp::ActionSetS::toSetValue(fsp::SetS& setv)
 
     setv.clear();
 
-    for (set<unsigned int>::iterator it = actions.begin();
+    for (ActionBitset::iterator it = actions.begin();
                     it != actions.end(); it++) {
         setv += at.lookup(*it);
     }
@@ -485,9 +485,9 @@ void fsp::ActionSetS::print() const
 {
     cout << "ActionSet: ";
     cout << "{";
-    for (set<unsigned int>::const_iterator it = actions.begin();
+    for (ActionBitset::const_iterator it = actions.begin();
                     it != actions.end(); it++) {
-        set<unsigned int>::const_iterator jt = it;
+        ActionBitset::const_iterator jt = it;
 
         cout << *it;
         if ((++jt) != actions.end()) {
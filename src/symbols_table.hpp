@@ -22,6 +22,7 @@
 #define __STRINGS__TABLE__H__
 
 #include "smart_pointers.hpp"
+#include "action_bitset.hpp"
 
 #include <iostream>
 #include <vector>
@@ -69,6 +70,9 @@ struct Symbol {
     DBR(unsigned delegated);
 
     Symbol() { refcount = 0; DBR(delegated = 0); }
+    /* A copy is a new object, which is not referenced by anyone yet. */
+    Symbol(const Symbol&) { refcount = 0; DBR(delegated = 0); }
+    Symbol& operator=(const Symbol&) { return *this; }
 
     virtual void print() const { };
     virtual const char *className() const = 0;
@@ -169,7 +173,7 @@ struct PriorityS: public Symbol {
 };
 
 struct ActionSetS : public Symbol {
-    set<unsigned int> actions;
+    ActionBitset actions;
 
     bool add(unsigned int a);
     bool lookup(unsigned int a) const;
@@ -0,0 +1,342 @@
+/*
+ *  fspc symmetry reduction support
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "symmetry.hpp"
+#include "lts.hpp"
+
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+
+fsp::Reduction::Reduction(const vector< SmartPtr<Lts> >& v) : expanded(NULL)
+{
+    for (unsigned int i = 0; i < v.size(); i++) {
+        components.push_back(new Lts(*v[i]));
+    }
+}
+
+fsp::Reduction::~Reduction()
+{
+    for (unsigned int i = 0; i < components.size(); i++) {
+        delete components[i];
+    }
+    delete expanded;
+}
+
+fsp::Symmetry::Symmetry(const vector< SmartPtr<Lts> >& v) : Reduction(v),
+                                                            full(false),
+                                                            table(NULL)
+{
+}
+
+fsp::Symmetry::~Symmetry()
+{
+    delete table;
+}
+
+/* Two LTSs have the same structure if they only differ in the edge
+   actions. */
+bool fsp::Symmetry::same_structure(const fsp::Lts& p, const fsp::Lts& q)
+{
+    if (p.numStates() != q.numStates() ||
+                    p.alphabetSize() != q.alphabetSize()) {
+        return false;
+    }
+
+    for (int i = 0; i < p.numStates(); i++) {
+        EdgeRange np = p.edges(i);
+        EdgeRange nq = q.edges(i);
+
+        if (np.size() != nq.size() || p.get_type(i) != q.get_type(i)) {
+            return false;
+        }
+        for (unsigned int j = 0; j < np.size(); j++) {
+            if (np[j].dest != nq[j].dest) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Compute the action renaming associated to the permutation 'perm' of
+   the replicated components (the k-th one is mapped onto the
+   'perm[k]'-th one). Returns false if the permutation is not a
+   symmetry, that is if the renaming is not a one-to-one function (e.g.
+   because an action shared by two replicated components would be
+   mapped onto two different actions) or if it does not preserve the
+   other components. */
+bool fsp::Symmetry::symmetry_map(const vector<unsigned int>& perm,
+                                 vector<uint32_t>& result) const
+{
+    vector<bool> replicated(components.size(), false);
+
+    unsigned int na = ActionsTable::getref().size();
+    vector<bool> assigned(na, false);
+    vector<bool> used(na, false);
+
+    result.resize(na);
+    for (unsigned int a = 0; a < na; a++) {
+        result[a] = a;
+    }
+
+    for (unsigned int k = 0; k < names.size(); k++) {
+        for (unsigned int i = 0; i < names[k].size(); i++) {
+            uint32_t a = names[k][i];
+            uint32_t b = names[perm[k]][i];
+
+            if (a == 0) {
+                /* The tau action is never renamed. */
+                continue;
+            }
+            if (assigned[a]) {
+                if (result[a] != b) {
+                    return false;
+                }
+            } else {
+                if (used[b]) {
+                    return false;
+                }
+                assigned[a] = used[b] = true;
+                result[a] = b;
+            }
+        }
+    }
+
+    for (unsigned int k = 0; k < slots.size(); k++) {
+        replicated[slots[k]] = true;
+    }
+    for (unsigned int i = 0; i < components.size(); i++) {
+        if (!replicated[i] && !preserved(*components[i], result)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Return true if the action renaming 'map' maps 'lts' onto itself,
+   without moving its states. */
+bool fsp::Symmetry::preserved(const fsp::Lts& lts,
+                              const vector<uint32_t>& map) const
+{
+    vector< pair<uint32_t, uint32_t> > x, y;
+
+    for (ActionBitset::const_iterator it = lts.alphabet.begin();
+                                        it != lts.alphabet.end(); it++) {
+        if (!lts.alphabet.count(map[*it])) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < lts.numStates(); i++) {
+        EdgeRange children = lts.edges(i);
+
+        x.clear();
+        y.clear();
+        for (unsigned int j = 0; j < children.size(); j++) {
+            x.push_back(make_pair(children[j].action, children[j].dest));
+            y.push_back(make_pair(map[children[j].action],
+                                  children[j].dest));
+        }
+        sort(x.begin(), x.end());
+        sort(y.begin(), y.end());
+        if (x != y) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Look for a symmetry among the components 'v' of a parallel
+   composition. The replicated components are the largest set of
+   components having the same structure. Returns NULL if there is no
+   symmetry. */
+fsp::Symmetry *fsp::Symmetry::detect(const vector< SmartPtr<Lts> >& v)
+{
+    vector<unsigned int> leader(v.size());
+    vector<unsigned int> count(v.size(), 0);
+    vector<uint32_t> pattern;
+    vector<unsigned int> perm;
+    vector<uint32_t> renaming;
+    unsigned int best = 0;
+    unsigned int n;
+    Symmetry *sym;
+
+    for (unsigned int i = 0; i < v.size(); i++) {
+        leader[i] = i;
+        for (unsigned int j = 0; j < i; j++) {
+            if (leader[j] == j && same_structure(*v[j], *v[i])) {
+                leader[i] = j;
+                break;
+            }
+        }
+        count[leader[i]]++;
+        if (count[leader[i]] > count[best]) {
+            best = leader[i];
+        }
+    }
+
+    if (v.size() < 2 || count[best] < 2) {
+        return NULL;
+    }
+
+    sym = new Symmetry(v);
+    for (unsigned int i = 0; i < v.size(); i++) {
+        if (leader[i] == best) {
+            sym->slots.push_back(i);
+        }
+    }
+    n = sym->slots.size();
+    perm.resize(n);
+
+    /* Align the actions of the replicated components: the edges of
+       the same state must use corresponding actions. */
+    sym->names.resize(n);
+    for (unsigned int k = 0; k < n; k++) {
+        const Lts& lts = *v[sym->slots[k]];
+        vector<uint32_t>& names = sym->names[k];
+        map<uint32_t, uint32_t> position;
+        unsigned int e = 0;
+
+        for (int i = 0; i < lts.numStates(); i++) {
+            EdgeRange children = lts.edges(i);
+
+            for (unsigned int j = 0; j < children.size(); j++, e++) {
+                uint32_t a = children[j].action;
+                map<uint32_t, uint32_t>::iterator it = position.find(a);
+
+                if (it == position.end()) {
+                    it = position.insert(make_pair(a, names.size())).first;
+                    names.push_back(a);
+                }
+                if (k == 0) {
+                    pattern.push_back(it->second);
+                } else if (pattern[e] != it->second ||
+                           (a == 0) != (sym->names[0][it->second] == 0)) {
+                    delete sym;
+                    return NULL;
+                }
+            }
+        }
+
+        /* Actions that are not used by any edge cannot be aligned. */
+        for (ActionBitset::const_iterator it = lts.alphabet.begin();
+                                        it != lts.alphabet.end(); it++) {
+            if (!position.count(*it)) {
+                delete sym;
+                return NULL;
+            }
+        }
+    }
+
+    /* The full symmetric group is generated by the transpositions of
+       adjacent replicated components, the cyclic group by a single
+       rotation. */
+    sym->full = true;
+    for (unsigned int g = 0; sym->full && g + 1 < n; g++) {
+        for (unsigned int k = 0; k < n; k++) {
+            perm[k] = k;
+        }
+        swap(perm[g], perm[g + 1]);
+        if (sym->symmetry_map(perm, renaming)) {
+            sym->generators.push_back(renaming);
+        } else {
+            sym->full = false;
+            sym->generators.clear();
+        }
+    }
+
+    if (!sym->full) {
+        for (unsigned int k = 0; k < n; k++) {
+            perm[k] = (k + 1) % n;
+        }
+        if (!sym->symmetry_map(perm, renaming)) {
+            delete sym;
+            return NULL;
+        }
+        sym->generators.push_back(renaming);
+    }
+
+    return sym;
+}
+
+/* Replace the composite state 'tuple' with the canonical representative
+   of its orbit: the replicated components states are sorted (full
+   symmetric group) or rotated so that they are lexicographically
+   minimal (cyclic group). */
+void fsp::Symmetry::canonical(uint32_t *tuple) const
+{
+    unsigned int n = slots.size();
+    vector<uint32_t> values(n);
+    unsigned int best = 0;
+
+    for (unsigned int k = 0; k < n; k++) {
+        values[k] = tuple[slots[k]];
+    }
+
+    if (full) {
+        sort(values.begin(), values.end());
+        for (unsigned int k = 0; k < n; k++) {
+            tuple[slots[k]] = values[k];
+        }
+        return;
+    }
+
+    /* The rotation starting at 'values[j]' is compared with the
+       best one found so far. */
+    for (unsigned int j = 1; j < n; j++) {
+        for (unsigned int k = 0; k < n; k++) {
+            uint32_t x = values[(j + k) % n];
+            uint32_t y = values[(best + k) % n];
+
+            if (x != y) {
+                if (x < y) {
+                    best = j;
+                }
+                break;
+            }
+        }
+    }
+    for (unsigned int k = 0; k < n; k++) {
+        tuple[slots[k]] = values[(best + k) % n];
+    }
+}
+
+/* Return true if the set of 'actions' is mapped onto itself by the
+   symmetries. */
+bool fsp::Symmetry::invariant(const ActionBitset& actions) const
+{
+    for (unsigned int g = 0; g < generators.size(); g++) {
+        const vector<uint32_t>& map = generators[g];
+
+        for (ActionBitset::const_iterator it = actions.begin();
+                                            it != actions.end(); it++) {
+            if (*it < map.size() && !actions.count(map[*it])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
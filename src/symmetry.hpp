@@ -0,0 +1,108 @@
+/*
+ *  fspc symmetry reduction support
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __SYMMETRY__HH
+#define __SYMMETRY__HH
+
+#include "symbols_table.hpp"
+#include "state_table.hpp"
+
+#include <vector>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+
+namespace fsp {
+
+class Lts;
+
+/* The components of a composite LTS computed with a reduction (partial
+   order or symmetry reduction). The reduced LTS only preserves some
+   properties of the composition, so the LTS without reduction is
+   computed from the components when it is needed (see
+   Lts::unreduced()). */
+class Reduction {
+    Reduction(const Reduction&);
+    Reduction& operator=(const Reduction&);
+
+  public:
+    /* Private copies of the components. They are cheap, since the
+       copies share the frozen transitions (see Lts). */
+    vector<Lts *> components;
+
+    /* The LTS without reduction, built on demand. */
+    Lts *expanded;
+
+    Reduction(const vector< SmartPtr<Lts> >& v);
+    virtual ~Reduction();
+};
+
+/* A symmetry of a parallel composition. Some of the components (the
+   replicated ones, e.g. the bodies of a 'forall' or the processes
+   'a:P || b:P || c:P') are identical up to a renaming of their actions,
+   while the other ones are not modified by that renaming. Permuting
+   the replicated components then maps the composite LTS onto itself,
+   and it is enough to explore one representative state for each orbit
+   of composite states. The group of permutations is either the cyclic
+   group of the rotations (e.g. a ring of dining philosophers) or the
+   full symmetric group (e.g. clients of a shared semaphore).
+
+   The representatives (the canonical composite states) are stored in
+   'table', so that the reduced LTS can be mapped back to the concrete
+   one (see Lts::symmetric_trace()). */
+class Symmetry: public Reduction {
+    /* The positions of the replicated components in 'components'. */
+    vector<unsigned int> slots;
+    bool full;
+
+    /* 'names[k]' contains the actions of the k-th replicated component,
+       listed in the order of their first occurrence. The actions
+       names[h][i] and names[k][i] correspond to each other. */
+    vector< vector<uint32_t> > names;
+
+    /* The action renamings of the generators of the group. */
+    vector< vector<uint32_t> > generators;
+
+    Symmetry(const Symmetry&);
+    Symmetry& operator=(const Symmetry&);
+
+    static bool same_structure(const Lts& p, const Lts& q);
+    bool symmetry_map(const vector<unsigned int>& perm,
+                      vector<uint32_t>& result) const;
+    bool preserved(const Lts& lts, const vector<uint32_t>& map) const;
+
+  public:
+    TreeTable *table;
+
+    Symmetry(const vector< SmartPtr<Lts> >& v);
+    ~Symmetry();
+    static Symmetry *detect(const vector< SmartPtr<Lts> >& v);
+    unsigned int replicas() const { return slots.size(); }
+    bool isFull() const { return full; }
+    void canonical(uint32_t *tuple) const;
+    bool invariant(const ActionBitset& actions) const;
+};
+
+}  /* namespace fsp */
+
+#endif
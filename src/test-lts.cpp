@@ -0,0 +1,206 @@
+/*
+ *  fspc LTS operators allocation test
+ *
+ *  Copyright (C) 2013-2014  Vincenzo Maffione
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The operators that overwrite an LTS move its graph (Lts::swap_nodes())
+   instead of copying it. Copying a graph which is not frozen costs one
+   allocation per state, so this test counts the allocations done by
+   each operator, and compares them with the ones of an equivalent
+   computation that does not need to copy anything. */
+
+#include "lts.hpp"
+#include "symbols_table.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+
+    if (!p) {
+        throw bad_alloc();
+    }
+    allocations++;
+
+    return p;
+}
+
+/* Not inlined, otherwise GCC warns that free() is called on a pointer
+   returned by operator new. */
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/* Allocations that do not depend on the size of the LTSs (e.g. the
+   growth of the vectors, or the alphabets). */
+static const unsigned long Slack = 256;
+
+static int failures = 0;
+
+static void check(const char *name, unsigned long count,
+                  unsigned long bound)
+{
+    cout << name << ": " << count << " allocations (at most "
+            << bound << ") ";
+    if (count <= bound) {
+        cout << "ok\n";
+    } else {
+        cout << "FAILED\n";
+        failures++;
+    }
+}
+
+/* A cycle of 'n' states, all the transitions being labeled with
+   'action'. The LTS is not frozen. */
+static fsp::Lts *ring(unsigned int n, const string& action)
+{
+    fsp::Lts *lts = new fsp::Lts(LtsNode::Normal);
+
+    for (unsigned int i = 1; i < n; i++) {
+        lts->add_state(LtsNode::Normal);
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        lts->add_edge(i, action, (i + 1) % n);
+    }
+
+    return lts;
+}
+
+/* compose(q) must not cost more than the composition of two const
+   operands. */
+static void test_compose(unsigned int n)
+{
+    fsp::SmartPtr<fsp::Lts> p = ring(n, "a");
+    fsp::SmartPtr<fsp::Lts> p2 = ring(n, "a");
+    fsp::Lts q(LtsNode::Normal);
+    unsigned long start, reference;
+
+    q.add_edge(0, "b", 0);
+
+    start = allocations;
+    {
+        fsp::Lts r(*p, q);
+    }
+    reference = allocations - start;
+
+    start = allocations;
+    p2->compose(q);
+    check("compose", allocations - start, reference + Slack);
+
+    /* Composing an LTS with itself. */
+    p->compose(*p);
+    if (p->numStates() != int(n)) {
+        cout << "compose with itself: " << p->numStates()
+                << " states, expected " << n << " FAILED\n";
+        failures++;
+    }
+}
+
+/* The pairwise fold of the N-ary constructor must not cost more than
+   the pairwise compositions. */
+static void test_fold()
+{
+    vector< fsp::SmartPtr<fsp::Lts> > v;
+    int selection = fsp::Lts::compose_selection;
+    unsigned long start, reference;
+
+    v.push_back(ring(100, "a"));
+    v.push_back(ring(10, "b"));
+    v.push_back(ring(5, "c"));
+    v.push_back(ring(2, "d"));
+    fsp::Lts::compose_selection = fsp::Lts::ComposeDeclarative;
+
+    start = allocations;
+    {
+        fsp::Lts r01(*v[0], *v[1]);
+        fsp::Lts r012(r01, *v[2]);
+        fsp::Lts r(r012, *v[3]);
+    }
+    reference = allocations - start;
+
+    start = allocations;
+    {
+        fsp::Lts r(v);
+    }
+    check("N-ary fold", allocations - start, reference + Slack);
+
+    fsp::Lts::compose_selection = selection;
+}
+
+/* labeling() with two labels needs a single copy of the LTS: the
+   second relabeled copy takes the graph of *this. The bound is between
+   one and two copies. */
+static void test_labeling(unsigned int n)
+{
+    fsp::SmartPtr<fsp::Lts> p = ring(n, "a");
+    fsp::SmartPtr<fsp::Lts> frozen = ring(n, "a");
+    fsp::SetS labels;
+    unsigned long start, reference;
+
+    labels += "x";
+    labels += "y";
+    frozen->freeze();
+
+    /* Copying a frozen LTS does not copy its transitions. */
+    start = allocations;
+    frozen->labeling(labels);
+    reference = allocations - start;
+
+    start = allocations;
+    p->labeling(labels);
+    check("labeling", allocations - start, reference + n + n / 2);
+}
+
+/* priority() filters the transitions in place: reduce() only allocates
+   the transitions of the resulting states. */
+static void test_priority(unsigned int n)
+{
+    fsp::SmartPtr<fsp::Lts> p = ring(n, "a");
+    fsp::SetS high;
+    unsigned long start;
+
+    p->add_edge(0, "c", 1);
+    high += "a";
+
+    start = allocations;
+    p->priority(high, false);
+    check("priority", allocations - start, p->numStates() + Slack);
+}
+
+int main()
+{
+    test_compose(10000);
+    test_fold();
+    test_labeling(300);
+    test_priority(10000);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+
+get_ms()
+{
+    echo $(($(date +%s%N)/1000000))
+}
+
+
+if [ -n "$1" ]; then
+    # Use a different fspcc command line invokation
+    FSPC="$1"
+else
+    FSPC="./fspcc"
+fi
+
+NAME="high-branching.fsp"
+
+if [ ! -f "tests/${NAME}" ]; then
+    echo "error: tests/${NAME} not found"
+    exit 255
+fi
+
+for i in 4 8 12 16 20 24
+do
+    cp tests/${NAME} comp-input.fsp
+    sed -i "s/M = 4/M = ${i}/g" comp-input.fsp
+
+    TSTART=$(get_ms)
+    ${FSPC} -i comp-input.fsp -o /dev/null
+    TEND=$(get_ms)
+
+    DIFF=$(( $TEND - $TSTART ))
+    echo "$(( ${i} * ${i} )) edges per state: ${DIFF} ms"
+
+    rm comp-input.fsp
+done
+
+echo ""
+echo "Branching test completed"
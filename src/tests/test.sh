@@ -7,11 +7,11 @@
 # "expect" list.
 match_expected_problems()
 {
-    i=$1                        # test index
-    FSPC=$2                     # fspc executable
-    TESTDIR=$3                  # test directory
-    EXPECT_LIST=${TESTDIR}/$4   # list of positive testcase indexes
-    PROBLEM=$4                  # the type of problem to check
+    local i=$1                        # test index
+    local FSPC=$2                     # fspc command line
+    local TESTDIR=$3                  # test directory
+    local EXPECT_LIST=${TESTDIR}/$4   # list of positive testcase indexes
+    local PROBLEM=$4                  # the type of problem to check
 
     ${FSPC} -i ${TESTDIR}/input${i}.fsp -S ${PROBLEM}.fsh > /dev/null
     NUM_PROBLEMS=$?
@@ -35,6 +35,9 @@ else
     FSPC="./fspcc"
 fi
 
+# Temporary files for the external memory composition (-x).
+XDIR=$(mktemp -d)
+
 ##################### tests on correct input ##################
 TESTDIR="tests/blackbox"
 
@@ -48,7 +51,7 @@ n = progress
 exit n
 EOF
 
-for i in {1..29}
+for i in {1..30}
 do
     if [ ! -f "${TESTDIR}/input${i}.fsp" ]; then
 	echo "error: ${TESTDIR}/input${i}.fsp not found"
@@ -74,11 +77,25 @@ do
 
     # Are there any deadlocks here? Check that the reported deadlocks
     # are consistent with the file "deadlock"
-    match_expected_problems ${i} ${FSPC} ${TESTDIR} deadlock
+    match_expected_problems ${i} "${FSPC}" ${TESTDIR} deadlock
 
     # Are there any progress violations here? Check that the reported
     # violations are consistent with the file "progress_violation"
-    match_expected_problems ${i} ${FSPC} ${TESTDIR} progress_violation
+    match_expected_problems ${i} "${FSPC}" ${TESTDIR} progress_violation
+done
+
+# The reductions of the composite processes, the on-the-fly checks and
+# the parallel and external memory engines must not change the reported
+# problems.
+for OPTS in "-r" "-y" "-c 100" "-j 4" "-r -j 4" "-y -j 4" "-x ${XDIR}" \
+            "-A declarative"
+do
+    for i in {1..30}
+    do
+        match_expected_problems ${i} "${FSPC} ${OPTS}" ${TESTDIR} deadlock
+        match_expected_problems ${i} "${FSPC} ${OPTS}" ${TESTDIR} progress_violation
+    done
+    echo "${TESTDIR} with ${OPTS} ok"
 done
 
 rm deadlock.fsh progress_violation.fsh
@@ -162,5 +179,33 @@ done
 rm alpha.fsh
 
 
+############ test the commands that explore a process ############
+# The ltl, safety and simulate commands, also on composite processes
+# that are explored on demand (lazy), rather than computed.
+TESTDIR="tests/shell"
+for i in {1..1}
+do
+    if [ ! -f "${TESTDIR}/input${i}.fsp" ]; then
+	echo "error: ${TESTDIR}/input${i}.fsp not found"
+	exit 255
+    fi
+    for OPTS in "" "-j 4" "-x ${XDIR}"
+    do
+        ${FSPC} ${OPTS} -i ${TESTDIR}/input${i}.fsp -S ${TESTDIR}/script${i}.fsh > new-output
+        diff ${TESTDIR}/output${i} new-output > /dev/null
+        var=$?
+        if [ "$var" != "0" ]; then
+            echo ""
+            echo "Test FAILED on ${TESTDIR}/input${i}.fsp with '${OPTS}'"
+            exit 1
+        fi
+        rm new-output
+    done
+    echo "${TESTDIR}/input$i ok"
+done
+
+rmdir ${XDIR}
+
+
 echo ""
 echo "Test OK"
@@ -984,10 +984,15 @@ Symbol *fsp::ActionLabelsNode::translate(FspDriver& c)
     return result;
 }
 
-fsp::SmartPtr<fsp::Lts> fsp::TreeNode::computePrefixActions(FspDriver& c,
-                                           const vector<TreeNode *>& als,
-                                           unsigned int idx,
-                                           vector<Context>& ctxcache)
+/* Translate the chain of ActionLabels als[idx..], attaching the
+   resulting tree of transitions to the state 'state' of 'lts'. The tree
+   is built directly into 'lts', so that no temporary LTS is created for
+   each branch. */
+void fsp::TreeNode::computePrefixActions(FspDriver& c,
+                                         const vector<TreeNode *>& als,
+                                         unsigned int idx,
+                                         vector<Context>& ctxcache,
+                                         Lts& lts, unsigned int state)
 {
     assert(idx < als.size());
     TDC(ActionLabelsNode, an, als[idx]);
@@ -995,7 +1000,6 @@ fsp::SmartPtr<fsp::Lts> fsp::TreeNode::computePrefixActions(FspDriver& c,
     const vector<TreeNode *>& elements = vec->val;
     vector<unsigned int> indexes(elements.size());
     vector<unsigned int> limits(elements.size());
-    fsp::SmartPtr<fsp::Lts> lts = new Lts(LtsNode::Normal);
     Context ctx = c.ctx;
 
     /* Initialize the 'indexes' vector. */
@@ -1071,7 +1075,7 @@ fsp::SmartPtr<fsp::Lts> fsp::TreeNode::computePrefixActions(FspDriver& c,
             delete r;
         }
 
-        fsp::SmartPtr<fsp::Lts> next;
+        unsigned int next;
         if (idx+1 >= als.size()) {
             /* This was the last ActionLabels in the chain: We create an
                incomplete node which represent an Lts which is the result
@@ -1085,17 +1089,18 @@ fsp::SmartPtr<fsp::Lts> fsp::TreeNode::computePrefixActions(FspDriver& c,
                    context. */
                 ctxcache.push_back(c.ctx);
             }
-            next = new Lts(LtsNode::Incomplete);
+            next = lts.add_state(LtsNode::Incomplete);
             /* Store the index in the 'priv' field. */
-            next->set_priv(0, ctxcache.size() - 1);
+            lts.set_priv(next, ctxcache.size() - 1);
         } else {
-            /* This was not the last ActionLabels in the chain. Get
-               the result of the remainder of the chain. */
-            next = computePrefixActions(c, als, idx + 1, ctxcache);
+            /* This was not the last ActionLabels in the chain. Attach
+               the remainder of the chain to a new state. */
+            next = lts.add_state(LtsNode::Normal);
+            computePrefixActions(c, als, idx + 1, ctxcache, lts, next);
         }
 
-        /* Attach 'next' to 'lts' using 'label'. */
-        lts->zerocat(*next, label);
+        /* Connect 'state' to 'next' using 'label'. */
+        lts.add_edge(state, label, next);
 
         /* Restore the saved context. */
         c.ctx = ctx;
@@ -1103,8 +1108,6 @@ fsp::SmartPtr<fsp::Lts> fsp::TreeNode::computePrefixActions(FspDriver& c,
         /* Increment indexes for the next 'label', and exits if there
            are no more combinations. */
     } while (next_set_indexes(elements, indexes, limits));
-
-    return lts;
 }
 
 Symbol *fsp::PrefixActionsNode::translate(FspDriver& c)
@@ -1341,7 +1344,10 @@ void fsp::process_ref_translate(FspDriver& c, const location& loc,
 
 	*res = is<fsp::Lts>(svp);
     } else {
-        assert(0);
+        /* A lazy composition is not stored in the 'processes' table
+           (see FspDriver::getLazyLts()). */
+        assert(c.lazy);
+        *res = NULL;
     }
 }
 
@@ -1480,7 +1486,8 @@ Symbol *fsp::ActionPrefixNode::translate(FspDriver& c)
 
         /* Compute an incomplete Lts, and the context related to
            each incomplete node (ctxcache). */
-        result->val = computePrefixActions(c, pa->val, 0, ctxcache);
+        result->val = new Lts(LtsNode::Normal);
+        computePrefixActions(c, pa->val, 0, ctxcache, *result->val, 0);
         /* Translate 'lp' under all the contexts in ctxcache. */
         for (unsigned int i=0; i<ctxcache.size(); i++) {
             LtsPtrS *lts;
@@ -1714,6 +1721,7 @@ void fsp::TreeNode::post_process_definition(FspDriver& c,
 
     res->name = name;
     res->cleanup();
+    res->freeze();
 
     /* Compute the LTS name extension with the parameter values
        used with this translation. */
@@ -1889,19 +1897,36 @@ Symbol *fsp::PrioritySNode::translate(FspDriver& c)
     return result;
 }
 
+/* Apply parallel composition to the components in 'pc', which is
+   deleted. If 'reduction' is true, partial order reduction is used.
+   If 'check' is not NULL, the composition is checked on-the-fly. */
+static fsp::LtsPtrS *parallel_composition(fsp::LtsVecS *pc,
+                                          bool reduction = false,
+                                          fsp::SafetyCheck *check = NULL)
+{
+    fsp::LtsPtrS *lts = new fsp::LtsPtrS;
+
+    assert(pc->val.size());
+    if (pc->val.size() == 1) {
+        lts->val = pc->val[0];
+    } else {
+        lts->val = new fsp::Lts(pc->val, reduction, check);
+    }
+    delete pc;
+
+    return lts;
+}
+
 void fsp::CompositeBodyNode::combination(FspDriver& c, Symbol *r,
                                         string index, bool first)
 {
-    /* Translate the CompositedBodyNode using the current context. */
+    /* Translate the CompositedBodyNode using the current context, and
+       collect the result: the components will be composed all
+       together by the caller. */
     RDC(LtsPtrS, cb, children[2]->translate(c));
-    LtsPtrS *result = symbol_downcast<LtsPtrS>(r);
+    LtsVecS *result = symbol_downcast<LtsVecS>(r);
 
-    if (first) {
-        first = false;
-        result->val = cb->val;
-    } else {
-        result->val->compose(*cb->val);
-    }
+    result->val.push_back(cb->val);
     delete cb;
 }
 
@@ -1962,14 +1987,26 @@ Symbol *fsp::CompositeBodyNode::translate(FspDriver& c)
         delete expr;
 
         return lts;
-    } else if (children.size() == 6) {
+    } else if (children.size() == 6 || children.size() == 3) {
+        return parallel_composition(translate_components(c));
+    } else {
+        assert(0);
+    }
+
+    return NULL;
+}
+
+/* Translate the components of a parallel composition, returning NULL
+   if this CompositeBodyNode is not a parallel composition. */
+fsp::LtsVecS *fsp::CompositeBodyNode::translate_components(FspDriver& c)
+{
+    if (children.size() == 6) {
         /* sharing_OPT labeling_OPT ( parallel_composition ) relabeling_OPT
          */
         TDCS(SharingNode, shn, children[0]);
         TDCS(LabelingNode, lbn, children[1]);
         RDC(LtsVecS, pc, children[3]->translate(c));
         TDCS(RelabelingNode, rln, children[5]);
-        LtsPtrS *lts = new LtsPtrS;
 
         /* Apply the process labeling operator to each component process
            separately, before parallel composition. */
@@ -2004,28 +2041,18 @@ Symbol *fsp::CompositeBodyNode::translate(FspDriver& c)
             delete rl;
         }
 
-        /* Apply parallel composition. */
-        assert(pc->val.size());
-        lts->val = pc->val[0];
-        for (unsigned int k=1; k<pc->val.size(); k++) {
-            lts->val->compose(*pc->val[k]);
-        }
-        delete pc;
-
-        return lts;
+        return pc;
     } else if (children.size() == 3) {
         /* FORALL index_ranges composite_body */
         RDC(TreeNodeVecS, ir, children[1]->translate(c));
-        LtsPtrS *lts = new LtsPtrS;
+        LtsVecS *pc = new LtsVecS;
 
         /* Only translate 'index_ranges', while 'composite_body'
            will be translated in the loop below. */
-        for_each_combination(c, lts, ir->val, this);
+        for_each_combination(c, pc, ir->val, this);
         delete ir;
 
-        return lts;
-    } else {
-        assert(0);
+        return pc;
     }
 
     return NULL;
@@ -2054,15 +2081,321 @@ Symbol *fsp::ParallelCompNode::translate(FspDriver& c)
     return result;
 }
 
+/* Compositional minimization step: hide the actions of 'lts' that are
+   hidden by 'hi' and not contained in 'shared' (the actions used by the
+   other processes involved in the parallel composition), and minimize
+   the result. */
+static void compositional_reduction(FspDriver& c, fsp::Lts& lts,
+                                    const fsp::HidingS& hi,
+                                    const fsp::ActionBitset& shared)
+{
+    set<unsigned int> hidden;
+    set<unsigned int> local;
+    stringstream ss;
+
+    lts.hiddenActions(hi.setv, hi.interface, hidden);
+    for (set<unsigned int>::iterator it = hidden.begin();
+                                    it != hidden.end(); it++) {
+        if (!shared.count(*it)) {
+            local.insert(*it);
+        }
+    }
+
+    c.stats.states_before += lts.numStates();
+    lts.hiding(local);
+    lts.cleanup();
+    lts.minimize(ss);
+    c.stats.states_after += lts.numStates();
+    c.stats.minimized++;
+}
+
+/* Composition planner: choose the next two LTSs in 'items' to be
+   composed. The alphabet of each item is in 'alpha', while 'hidden'
+   contains the actions hidden by the composite process. The pair that
+   maximizes the fraction of actions that are either synchronized or
+   become local (and so can be hidden and minimized away) is chosen,
+   since it is likely to give a small intermediate result. Ties are
+   broken choosing the smaller product of the state counts. */
+static void composition_plan_step(const vector< fsp::SmartPtr<fsp::Lts> >& items,
+                                  const vector<fsp::ActionBitset>& alpha,
+                                  const fsp::ActionBitset& hidden,
+                                  unsigned int& first, unsigned int& second)
+{
+    double best_score = -1.0;
+    uint64_t best_size = 0;
+
+    first = 0;
+    second = 1;
+    for (unsigned int i = 0; i < items.size(); i++) {
+        for (unsigned int j = i + 1; j < items.size(); j++) {
+            uint64_t size = uint64_t(items[i]->numStates()) *
+                                        items[j]->numStates();
+            fsp::ActionBitset actions = alpha[i];
+            fsp::ActionBitset sync = alpha[i];
+            fsp::ActionBitset local;
+            double score;
+
+            actions.unite(alpha[j]);
+            sync.intersect(alpha[j]);
+
+            /* The actions that are not synchronized can become local if
+               they are hidden and no other item uses them. */
+            local = actions;
+            local.subtract(sync).intersect(hidden);
+            for (unsigned int k = 0; !local.empty() &&
+                                            k < items.size(); k++) {
+                if (k != i && k != j) {
+                    local.subtract(alpha[k]);
+                }
+            }
+            score = actions.size() ? double(sync.size() + local.size()) /
+                                            actions.size() : 1.0;
+
+            if (score > best_score ||
+                        (score == best_score && size < best_size)) {
+                best_score = score;
+                best_size = size;
+                first = i;
+                second = j;
+            }
+        }
+    }
+}
+
+/* Parallel composition with compositional minimization. Each component
+   in 'pc', and each intermediate result of the composition, is reduced
+   with compositional_reduction() before being composed. The order of
+   the composition (a binary tree) is chosen by composition_plan_step(),
+   and logged into c.stats. The 'pc' object is deleted. */
+static fsp::LtsPtrS *compositional_composition(FspDriver& c,
+                                               fsp::LtsVecS *pc,
+                                               const fsp::HidingS& hi,
+                                               const string& name)
+{
+    vector< fsp::SmartPtr<fsp::Lts> > items = pc->val;
+    vector<fsp::ActionBitset> alpha(items.size());
+    vector<string> plan(items.size());
+    set<unsigned int> hidden_set;
+    fsp::ActionBitset hidden;
+    fsp::LtsPtrS *lts = new fsp::LtsPtrS;
+
+    assert(items.size());
+    delete pc;
+
+    for (unsigned int k = 0; k < items.size(); k++) {
+        items[k]->mergeAlphabetInto(alpha[k]);
+        items[k]->hiddenActions(hi.setv, hi.interface, hidden_set);
+        plan[k] = items[k]->name.size() ? items[k]->name : "?";
+    }
+    hidden = fsp::ActionBitset(hidden_set);
+
+    /* Reduce each component. Only the actions that are not used by any
+       other component can be hidden. */
+    for (unsigned int k = 0; k < items.size(); k++) {
+        fsp::ActionBitset shared;
+
+        for (unsigned int j = 0; j < items.size(); j++) {
+            if (j != k) {
+                shared.unite(alpha[j]);
+            }
+        }
+        compositional_reduction(c, *items[k], hi, shared);
+    }
+
+    while (items.size() > 1) {
+        fsp::ActionBitset shared;
+        unsigned int i, j;
+
+        composition_plan_step(items, alpha, hidden, i, j);
+        items[i]->compose(*items[j]);
+        alpha[i].unite(alpha[j]);
+        plan[i] = "(" + plan[i] + " || " + plan[j] + ")";
+        items.erase(items.begin() + j);
+        alpha.erase(alpha.begin() + j);
+        plan.erase(plan.begin() + j);
+
+        for (unsigned int k = 0; k < items.size(); k++) {
+            if (k != i) {
+                shared.unite(alpha[k]);
+            }
+        }
+        compositional_reduction(c, *items[i], hi, shared);
+    }
+
+    c.stats.plans.push_back(name + ": " + plan[0]);
+    lts->val = items[0];
+
+    return lts;
+}
+
+/* Compute the actions of the composition of the components in 'pc'
+   that are hidden by 'hin'. */
+static void hidden_actions(FspDriver& c, fsp::LtsVecS *pc,
+                           HidingInterfNode *hin, set<unsigned int>& result)
+{
+    RDC(HidingS, hi, hin->translate(c));
+    fsp::Lts alpha(LtsNode::Normal);
+
+    for (unsigned int k = 0; k < pc->val.size(); k++) {
+        alpha.mergeAlphabetFrom(pc->val[k]->getAlphabet());
+    }
+    alpha.hiddenActions(hi->setv, hi->interface, result);
+    delete hi;
+}
+
+/* Compose the components in 'pc' (which is deleted) with symmetry
+   reduction. Returns NULL, leaving 'pc' untouched, if the components
+   have no symmetry, or if the actions hidden by 'hin' are not
+   symmetric. */
+static fsp::LtsPtrS *symmetric_composition(FspDriver& c, fsp::LtsVecS *pc,
+                                           HidingInterfNode *hin,
+                                           const string& name)
+{
+    shared_ptr<fsp::Symmetry> sym(fsp::Symmetry::detect(pc->val));
+    fsp::LtsPtrS *lts;
+    stringstream ss;
+
+    if (!sym) {
+        return NULL;
+    }
+
+    if (hin) {
+        set<unsigned int> hidden;
+
+        hidden_actions(c, pc, hin, hidden);
+        if (!sym->invariant(ActionBitset(hidden))) {
+            return NULL;
+        }
+    }
+
+    lts = new fsp::LtsPtrS;
+    lts->val = new fsp::Lts(sym);
+    delete pc;
+
+    ss << name << ": " << sym->replicas() << " replicated components ("
+        << (sym->isFull() ? "permutations" : "rotations") << "), "
+        << lts->val->numStates() << " states";
+    c.stats.symmetries.push_back(ss.str());
+
+    return lts;
+}
+
+/* Output the violations found by an on-the-fly safety check. If the
+   check was stopped, the compilation is aborted. */
+static void safety_check_report(FspDriver& c, fsp::SafetyCheck& check)
+{
+    cout << check.report.str();
+    if (check.stopped()) {
+        cout << "Safety check: stopped after " << check.found
+                << " violation(s) in process " << check.name << "\n";
+        c.clear();
+        exit(-1);
+    }
+}
+
 Symbol *fsp::CompositeDefNode::translate(FspDriver& c)
 {
     /* || process_id param_OPT = composite_body priority_OPT hiding_OPT . */
     RDC(StringS, id, children[1]->translate(c));
-    RDC(LtsPtrS, body, children[4]->translate(c));
+    TDCS(CompositeBodyNode, cbn, children[4]);
     TDCS(PrioritySNode, prn, children[5]);
     TDCS(HidingInterfNode, hin, children[6]);
+    LtsPtrS *body = NULL;
+    bool lazy = c.lazy_request;
+
+    /* With a lazy composition request (see FspDriver::getLazyLts()),
+       only the components are translated, and the composite LTS is
+       stored into 'c.lazy' rather than into the 'processes' table.
+       The request does not apply to the composite processes referred
+       by this one. Priority needs the whole product, so in that
+       case the composition is done as usual. */
+    c.lazy_request = false;
+    if (lazy && cbn && !prn) {
+        LtsVecS *pc = cbn->translate_components(c);
+
+        if (pc && pc->val.size() > 1) {
+            string extension;
+
+            c.lazy = new fsp::LazyLts(pc->val);
+            if (hin) {
+                set<unsigned int> hidden;
+
+                hidden_actions(c, pc, hin, hidden);
+                c.lazy->hiding(hidden);
+            }
+            lts_name_extension(c.parameters.defaults, extension);
+            c.lazy->name = id->val + extension;
+            delete pc;
+            delete id;
+
+            return NULL;
+        } else if (pc) {
+            body = parallel_composition(pc);
+        }
+    }
+
+    /* The base is the composite body. With compositional minimization,
+       the hiding operator is also applied to the components of the
+       body, as long as there is no priority operator (which must be
+       applied before hiding). */
+    if (!body && c.cop.compositional && cbn && hin && !prn) {
+        LtsVecS *pc = cbn->translate_components(c);
+
+        if (pc) {
+            RDC(HidingS, hi, hin->translate(c));
+
+            string extension;
+
+            lts_name_extension(c.parameters.defaults, extension);
+            body = compositional_composition(c, pc, *hi,
+                                             id->val + extension);
+            delete hi;
+        }
+    }
 
-    /* The base is the composite body. */
+    /* With partial order reduction, the body is composed exploring only
+       a subset of the interleavings. This is only done if no other
+       process refers to this one, and if there is no priority operator,
+       since the reduced LTS only preserves deadlocks and property
+       violations. The same restriction on priority applies to the
+       on-the-fly safety check, since priority can remove transitions
+       (and so introduce deadlocks) after the composition, and to
+       symmetry reduction, which is preferred to partial order reduction
+       when the components are symmetric. */
+    if (!body && cbn && !prn && (c.cop.max_violations ||
+            ((c.cop.partial_order || c.cop.symmetry) &&
+                                    !c.deps.isReferenced(id->val)))) {
+        bool reduction = c.cop.partial_order &&
+                                !c.deps.isReferenced(id->val);
+        LtsVecS *pc = cbn->translate_components(c);
+
+        if (pc && c.cop.max_violations) {
+            string extension;
+
+            lts_name_extension(c.parameters.defaults, extension);
+            fsp::SafetyCheck check(id->val + extension,
+                                   c.cop.max_violations);
+
+            body = parallel_composition(pc, reduction, &check);
+            safety_check_report(c, check);
+        } else if (pc) {
+            if (c.cop.symmetry) {
+                string extension;
+
+                lts_name_extension(c.parameters.defaults, extension);
+                body = symmetric_composition(c, pc, hin,
+                                             id->val + extension);
+            }
+            if (!body) {
+                body = parallel_composition(pc, reduction);
+            }
+        }
+    }
+    if (!body) {
+        RDC(LtsPtrS, b, children[4]->translate(c));
+
+        body = b;
+    }
 
     /* Apply the priority operator. */
     if (prn) {
@@ -46,10 +46,11 @@ class TreeNode : public ParametricTranslator {
         SetS computeActionLabels(FspDriver& c, SetS base,
                                      const vector<TreeNode*>& elements,
                                      unsigned int idx);
-        SmartPtr<Lts> computePrefixActions(FspDriver& c,
+        void computePrefixActions(FspDriver& c,
                                      const vector<TreeNode *>& als,
                                      unsigned int idx,
-                                     vector<Context>& ctxcache);
+                                     vector<Context>& ctxcache,
+                                     Lts& lts, unsigned int state);
         void post_process_definition(FspDriver& c,
                                      SmartPtr<Lts> res,
                                      const string& name);
@@ -464,6 +465,7 @@ class CompositeBodyNode : public LtsTreeNode {
         string getClassName() const { return className(); }
         CompositeBodyNode() : LtsTreeNode() { }
         Symbol *translate(FspDriver& c);
+        LtsVecS *translate_components(FspDriver& c);
         void combination(FspDriver& dr, Symbol *r,
                          string index, bool first);
 };